@@ -132,10 +132,20 @@ mkdir -p %{buildroot}/%{icondirectory}
 %qmake5_install
 
 
-%post -p /sbin/ldconfig
+%post
+/sbin/ldconfig
+# Precompile the notification category definitions, lipstick falls back to the files if this fails
+%{_bindir}/categorydefinitioncompiler %{_datadir}/lipstick/notificationcategories || :
 
 %postun -p /sbin/ldconfig
 
+# Recompile the notification category definitions when other packages install or remove them
+%filetriggerin -- %{_datadir}/lipstick/notificationcategories
+%{_bindir}/categorydefinitioncompiler %{_datadir}/lipstick/notificationcategories || :
+
+%filetriggerpostun -- %{_datadir}/lipstick/notificationcategories
+%{_bindir}/categorydefinitioncompiler %{_datadir}/lipstick/notificationcategories || :
+
 %files
 %defattr(-,root,root,-)
 %config %{_sysconfdir}/dbus-1/system.d/lipstick.conf
@@ -147,6 +157,8 @@ mkdir -p %{buildroot}/%{icondirectory}
 %dir %{_datadir}/lipstick
 %dir %{_datadir}/lipstick/notificationcategories
 %{_datadir}/lipstick/notificationcategories/*.conf
+%ghost %{_datadir}/lipstick/notificationcategories.bundle
+%{_bindir}/categorydefinitioncompiler
 %{_datadir}/lipstick/androidnotificationpriorities
 %dir %{icondirectory}
 
@@ -0,0 +1,309 @@
+// This file is part of lipstick, a QML desktop library
+//
+// Copyright (c) 2015 Jolla Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License version 2.1 as published by the Free Software Foundation
+// and appearing in the file LICENSE.LGPL included in the packaging
+// of this file.
+//
+// This code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+
+#include "launcherentrycache.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QVector>
+#include <mdesktopentry.h>
+
+// Identifies the launcher entry cache files ("LENT")
+static const quint32 CACHE_MAGIC = 0x4c454e54;
+
+// The version of the launcher entry cache file format
+static const quint32 CACHE_VERSION = 1;
+
+static QString defaultCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/lipstick/launcherentries.dat");
+}
+
+// Reads a string list without reserving space for a length read from a possibly corrupted file
+static void readStringList(QDataStream &stream, QStringList *list)
+{
+    quint32 count = 0;
+    stream >> count;
+
+    // Each string takes at least the four bytes of its length
+    if (stream.status() != QDataStream::Ok || count > stream.device()->bytesAvailable() / 4) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+
+    list->clear();
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString string;
+        stream >> string;
+        list->append(string);
+    }
+}
+
+Q_GLOBAL_STATIC_WITH_ARGS(LauncherEntryCache, entryCacheInstance, (defaultCachePath()))
+
+LauncherEntry::LauncherEntry()
+    : noDisplay(false)
+    , isValid(false)
+{
+}
+
+LauncherEntry::LauncherEntry(const MDesktopEntry &desktopEntry)
+    : exec(desktopEntry.exec())
+    , name(desktopEntry.name())
+    , nameUnlocalized(desktopEntry.nameUnlocalized())
+    , type(desktopEntry.type())
+    , icon(desktopEntry.icon())
+    , categories(desktopEntry.categories())
+    , noDisplay(desktopEntry.noDisplay())
+    , isValid(desktopEntry.isValid())
+{
+}
+
+// Reads every stride'th desktop file starting from the first one, so that
+// each task writes to desktop entries of its own.
+//
+// Only the key files are read here. Constructing an MDesktopEntry just reads
+// and parses the file, but its accessors are not thread-safe: name() loads the
+// translation catalog of the entry and installs it on the application, which
+// sends a LanguageChange event to it. The fields are therefore only read from
+// the desktop entries on the thread the cache is used from.
+class LauncherEntryCache::ParseTask : public QRunnable
+{
+public:
+    ParseTask(const QStringList &filePaths, QVector<QSharedPointer<MDesktopEntry> > *desktopEntries, int first, int stride)
+        : m_filePaths(filePaths), m_desktopEntries(desktopEntries->data()), m_first(first), m_stride(stride)
+    {
+    }
+
+    void run()
+    {
+        for (int i = m_first; i < m_filePaths.count(); i += m_stride) {
+            m_desktopEntries[i] = QSharedPointer<MDesktopEntry>(new MDesktopEntry(m_filePaths.at(i)));
+        }
+    }
+
+private:
+    const QStringList m_filePaths;
+    QSharedPointer<MDesktopEntry> *m_desktopEntries;
+    int m_first;
+    int m_stride;
+};
+
+LauncherEntryCache *LauncherEntryCache::instance()
+{
+    return entryCacheInstance();
+}
+
+LauncherEntryCache::LauncherEntryCache(const QString &path)
+    : m_path(path)
+    , m_locale(QLocale().name())
+    , m_changed(false)
+{
+    load();
+}
+
+LauncherEntryCache::~LauncherEntryCache()
+{
+}
+
+QSharedPointer<const LauncherEntry> LauncherEntryCache::entry(const QString &filePath)
+{
+    checkLocale();
+
+    const QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        // There's nothing to compare a cached entry with, so the file is only parsed
+        return QSharedPointer<const LauncherEntry>(new LauncherEntry(MDesktopEntry(filePath)));
+    }
+
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    const qint64 size = fileInfo.size();
+
+    QHash<QString, Record>::iterator it = m_records.find(filePath);
+    if (it != m_records.end() && it->modified == modified && it->size == size) {
+        return it->entry;
+    }
+
+    Record record;
+    record.modified = modified;
+    record.size = size;
+    record.entry = QSharedPointer<const LauncherEntry>(new LauncherEntry(MDesktopEntry(filePath)));
+    m_records.insert(filePath, record);
+    m_changed = true;
+
+    return record.entry;
+}
+
+void LauncherEntryCache::prefetch(const QStringList &filePaths)
+{
+    checkLocale();
+
+    QStringList parsePaths;
+    QVector<Record> records;
+    foreach (const QString &filePath, filePaths) {
+        const QFileInfo fileInfo(filePath);
+        if (!fileInfo.exists()) {
+            continue;
+        }
+
+        Record record;
+        record.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+        record.size = fileInfo.size();
+
+        QHash<QString, Record>::const_iterator it = m_records.constFind(filePath);
+        if (it == m_records.constEnd() || it->modified != record.modified || it->size != record.size) {
+            parsePaths.append(filePath);
+            records.append(record);
+        }
+    }
+
+    // A single file is parsed just as well when it is needed
+    if (parsePaths.count() < 2) {
+        return;
+    }
+
+    QVector<QSharedPointer<MDesktopEntry> > desktopEntries(parsePaths.count());
+    QThreadPool pool;
+    const int taskCount = qMin(qMax(pool.maxThreadCount(), 1), parsePaths.count());
+    for (int i = 0; i < taskCount; ++i) {
+        pool.start(new ParseTask(parsePaths, &desktopEntries, i, taskCount));
+    }
+    pool.waitForDone();
+
+    // The translated names are resolved here, on the thread the cache is used from
+    for (int i = 0; i < parsePaths.count(); ++i) {
+        records[i].entry = QSharedPointer<const LauncherEntry>(new LauncherEntry(*desktopEntries.at(i)));
+        m_records.insert(parsePaths.at(i), records.at(i));
+    }
+    m_changed = true;
+}
+
+void LauncherEntryCache::remove(const QString &filePath)
+{
+    if (m_records.remove(filePath) > 0) {
+        m_changed = true;
+    }
+}
+
+bool LauncherEntryCache::save()
+{
+    if (!m_changed) {
+        return false;
+    }
+
+    QHash<QString, Record>::iterator it = m_records.begin();
+    while (it != m_records.end()) {
+        if (QFile::exists(it.key())) {
+            ++it;
+        } else {
+            it = m_records.erase(it);
+        }
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write launcher entry cache:" << m_path << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << CACHE_MAGIC << CACHE_VERSION << m_locale << quint32(m_records.count());
+    for (it = m_records.begin(); it != m_records.end(); ++it) {
+        const LauncherEntry &entry = *it->entry;
+        stream << it.key() << it->modified << it->size
+               << entry.exec << entry.name << entry.nameUnlocalized << entry.type << entry.icon
+               << entry.categories << entry.noDisplay << entry.isValid;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Cannot write launcher entry cache:" << m_path << file.errorString();
+        return false;
+    }
+
+    m_changed = false;
+    return true;
+}
+
+void LauncherEntryCache::checkLocale()
+{
+    const QString locale = QLocale().name();
+    if (locale != m_locale) {
+        m_locale = locale;
+        m_records.clear();
+        m_changed = true;
+    }
+}
+
+void LauncherEntryCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString locale;
+    quint32 count = 0;
+    stream >> magic >> version >> locale >> count;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION || stream.status() != QDataStream::Ok) {
+        qWarning() << "Ignoring launcher entry cache in unknown format:" << m_path;
+        return;
+    }
+
+    if (locale != m_locale) {
+        // The cached names are in another language
+        return;
+    }
+
+    // The count is not trusted for reserving space, the records are read until the data ends
+    QHash<QString, Record> records;
+    for (quint32 i = 0; i < count; ++i) {
+        QString filePath;
+        Record record;
+        LauncherEntry *entry = new LauncherEntry;
+        record.entry = QSharedPointer<const LauncherEntry>(entry);
+        stream >> filePath >> record.modified >> record.size
+               >> entry->exec >> entry->name >> entry->nameUnlocalized >> entry->type >> entry->icon;
+        readStringList(stream, &entry->categories);
+        stream >> entry->noDisplay >> entry->isValid;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+        records.insert(filePath, record);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Ignoring corrupted launcher entry cache:" << m_path;
+        return;
+    }
+
+    m_records.swap(records);
+}
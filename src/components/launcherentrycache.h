@@ -0,0 +1,110 @@
+// This file is part of lipstick, a QML desktop library
+//
+// Copyright (c) 2015 Jolla Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License version 2.1 as published by the Free Software Foundation
+// and appearing in the file LICENSE.LGPL included in the packaging
+// of this file.
+//
+// This code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+
+#ifndef LAUNCHERENTRYCACHE_H
+#define LAUNCHERENTRYCACHE_H
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class MDesktopEntry;
+
+//! The fields of a desktop entry used by the launcher items.
+struct LauncherEntry
+{
+    LauncherEntry();
+    explicit LauncherEntry(const MDesktopEntry &desktopEntry);
+
+    QString exec;
+    QString name;
+    QString nameUnlocalized;
+    QString type;
+    QString icon;
+    QStringList categories;
+    bool noDisplay;
+    bool isValid;
+};
+
+/*!
+ * Caches the parsed desktop entries of the launcher items in a single file.
+ *
+ * Each entry is stored with the modification time and the size of its
+ * desktop file, and the desktop file is parsed again only if either of them
+ * has changed. The entries are localized, so the whole cache is discarded
+ * when the locale changes.
+ */
+class LauncherEntryCache
+{
+public:
+    //! Returns the cache shared by the launcher items.
+    static LauncherEntryCache *instance();
+
+    explicit LauncherEntryCache(const QString &path);
+    ~LauncherEntryCache();
+
+    /*!
+     * Returns the entry of a desktop file, parsing the file only if it has
+     * changed since the entry was cached.
+     *
+     * \param filePath the path of the desktop file
+     */
+    QSharedPointer<const LauncherEntry> entry(const QString &filePath);
+
+    /*!
+     * Parses the desktop files which are not cached or have changed since
+     * they were cached. The files are read in parallel, so that the entries
+     * of a large number of new files are ready by the time they are needed.
+     * The fields of the entries, including the translated names, are read
+     * on the calling thread.
+     *
+     * \param filePaths the paths of the desktop files
+     */
+    void prefetch(const QStringList &filePaths);
+
+    //! Removes the cached entry of a desktop file, so that it will be parsed again.
+    void remove(const QString &filePath);
+
+    /*!
+     * Writes the cache if it has changed since it was read or last saved.
+     * Entries of desktop files which no longer exist are dropped.
+     *
+     * \return \c true if the cache was written, \c false otherwise
+     */
+    bool save();
+
+private:
+    Q_DISABLE_COPY(LauncherEntryCache)
+
+    struct Record
+    {
+        qint64 modified;
+        qint64 size;
+        QSharedPointer<const LauncherEntry> entry;
+    };
+
+    class ParseTask;
+
+    void checkLocale();
+    void load();
+
+    QString m_path;
+    QString m_locale;
+    QHash<QString, Record> m_records;
+    bool m_changed;
+};
+
+#endif // LAUNCHERENTRYCACHE_H
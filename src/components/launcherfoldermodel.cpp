@@ -24,7 +24,15 @@
 #include <QTemporaryFile>
 #include <QStandardPaths>
 #include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
 #include <QStack>
+#include <QThreadPool>
+#include <QVector>
 #include <mdesktopentry.h>
 #include <glib.h>
 #include <QDebug>
@@ -331,6 +339,142 @@ void LauncherFolderItem::handleRemoved(QObject *item)
     emit saveNeeded();
 }
 
+// An element of a menu snapshot. The folder tree is flattened into a
+// sequence of elements in the order they appear in the menu file.
+struct MenuElement
+{
+    enum Type {
+        MenuStart,
+        MenuEnd,
+        Filename
+    };
+
+    MenuElement(Type type, const QString &text = QString(), const QString &directoryFile = QString())
+        : type(type), text(text), directoryFile(directoryFile)
+    {
+    }
+
+    Type type;
+    QString text;
+    QString directoryFile;
+};
+
+typedef QVector<MenuElement> MenuSnapshot;
+
+static void snapshotFolder(MenuSnapshot *menu, LauncherFolderItem *folder)
+{
+    menu->append(MenuElement(MenuElement::MenuStart, folder->title(), folder->directoryFile()));
+
+    for (int i = 0; i < folder->rowCount(); ++i) {
+        LauncherItem *item = qobject_cast<LauncherItem*>(folder->get(i));
+        if (item) {
+            if (!item->isTemporary())
+                menu->append(MenuElement(MenuElement::Filename, item->filename()));
+        } else if (LauncherFolderItem *subFolder = qobject_cast<LauncherFolderItem*>(folder->get(i))) {
+            snapshotFolder(menu, subFolder);
+        }
+    }
+
+    menu->append(MenuElement(MenuElement::MenuEnd));
+}
+
+static bool writeMenu(const QString &path, const MenuSnapshot &menu)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save apps menu" << path;
+        return false;
+    }
+
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    foreach (const MenuElement &element, menu) {
+        switch (element.type) {
+        case MenuElement::MenuStart:
+            xml.writeStartElement("Menu");
+            xml.writeTextElement("Name", element.text);
+            if (!element.directoryFile.isEmpty())
+                xml.writeTextElement("Directory", element.directoryFile);
+            break;
+        case MenuElement::MenuEnd:
+            xml.writeEndElement();
+            break;
+        case MenuElement::Filename:
+            xml.writeTextElement("Filename", element.text);
+            break;
+        }
+    }
+    xml.writeEndDocument();
+
+    if (!file.commit()) {
+        qWarning() << "Failed to save apps menu" << path;
+        return false;
+    }
+    return true;
+}
+
+// Writes menu snapshots in a thread of its own. Snapshots saved for the same
+// file while an earlier one is still waiting to be written replace it.
+class LauncherFolderModel::MenuWriter
+{
+public:
+    MenuWriter()
+        : mWritePending(false)
+    {
+        mPool.setMaxThreadCount(1);
+    }
+
+    ~MenuWriter()
+    {
+        waitForWrites();
+    }
+
+    void write(const QString &path, const MenuSnapshot &menu)
+    {
+        QMutexLocker locker(&mMutex);
+        mPendingMenus.insert(path, menu);
+        if (!mWritePending) {
+            mWritePending = true;
+            mPool.start(new Task(this));
+        }
+    }
+
+    void waitForWrites()
+    {
+        mPool.waitForDone();
+    }
+
+private:
+    class Task : public QRunnable
+    {
+    public:
+        explicit Task(MenuWriter *writer) : mWriter(writer) {}
+
+        void run()
+        {
+            QHash<QString, MenuSnapshot> menus;
+            {
+                QMutexLocker locker(&mWriter->mMutex);
+                menus.swap(mWriter->mPendingMenus);
+                mWriter->mWritePending = false;
+            }
+
+            QHash<QString, MenuSnapshot>::const_iterator it = menus.constBegin();
+            for ( ; it != menus.constEnd(); ++it)
+                writeMenu(it.key(), it.value());
+        }
+
+    private:
+        MenuWriter *mWriter;
+    };
+
+    QMutex mMutex;
+    QHash<QString, MenuSnapshot> mPendingMenus;
+    bool mWritePending;
+    QThreadPool mPool;
+};
+
 class DeferredLauncherModel : public LauncherModel
 {
 public:
@@ -347,6 +491,7 @@ public:
 LauncherFolderModel::LauncherFolderModel(QObject *parent)
     : LauncherFolderItem(parent)
     , mLauncherModel(new DeferredLauncherModel(this))
+    , mMenuWriter(new MenuWriter)
     , mLoading(false)
     , mInitialized(false)
 {
@@ -360,6 +505,7 @@ LauncherFolderModel::LauncherFolderModel(QObject *parent)
 LauncherFolderModel::LauncherFolderModel(InitializationMode, QObject *parent)
     : LauncherFolderItem(parent)
     , mLauncherModel(new DeferredLauncherModel(this))
+    , mMenuWriter(new MenuWriter)
     , mLoading(false)
     , mInitialized(false)
 {
@@ -368,6 +514,12 @@ LauncherFolderModel::LauncherFolderModel(InitializationMode, QObject *parent)
     connect(mLauncherModel, &LauncherModel::categoriesChanged, this, &LauncherFolderModel::categoriesChanged);
 }
 
+LauncherFolderModel::~LauncherFolderModel()
+{
+    // Waits for the pending menu to be written
+    delete mMenuWriter;
+}
+
 void LauncherFolderModel::initialize()
 {
     if (mInitialized)
@@ -509,36 +661,11 @@ static QString configurationFileForScope(const QString &scope)
 void LauncherFolderModel::save()
 {
     mSaveTimer.stop();
-    QFile file(configurationFileForScope(mLauncherModel->scope()));
-    if (!file.open(QIODevice::WriteOnly)) {
-        qWarning() << "Failed to save apps menu" << configFile();
-        return;
-    }
-
-    QXmlStreamWriter xml(&file);
-    xml.setAutoFormatting(true);
-    xml.writeStartDocument();
-    saveFolder(xml, this);
-    xml.writeEndDocument();
-}
 
-void LauncherFolderModel::saveFolder(QXmlStreamWriter &xml, LauncherFolderItem *folder)
-{
-    xml.writeStartElement("Menu");
-    xml.writeTextElement("Name", folder->title());
-    if (!folder->directoryFile().isEmpty())
-        xml.writeTextElement("Directory", folder->directoryFile());
-
-    for (int i = 0; i < folder->rowCount(); ++i) {
-        LauncherItem *item = qobject_cast<LauncherItem*>(folder->get(i));
-        if (item) {
-            if (!item->isTemporary())
-                xml.writeTextElement("Filename", item->filename());
-        } else if (LauncherFolderItem *subFolder = qobject_cast<LauncherFolderItem*>(folder->get(i))) {
-            saveFolder(xml, subFolder);
-        }
-    }
-    xml.writeEndElement();
+    // The folder tree is copied here, formatting and writing it is left to the writer thread
+    MenuSnapshot menu;
+    snapshotFolder(&menu, this);
+    mMenuWriter->write(configurationFileForScope(mLauncherModel->scope()), menu);
 }
 
 void LauncherFolderModel::load()
@@ -546,6 +673,9 @@ void LauncherFolderModel::load()
     mLoading = true;
     clear();
 
+    // Make sure the latest saved menu is read
+    mMenuWriter->waitForWrites();
+
     QFile file(configurationFileForScope(mLauncherModel->scope()));
     if (!file.open(QIODevice::ReadOnly)) {
         // We haven't saved a folder model yet - import all apps.
@@ -554,8 +684,7 @@ void LauncherFolderModel::load()
         return;
     }
 
-    QVector<bool> loadedItems(mLauncherModel->itemCount());
-    loadedItems.fill(false);
+    QSet<LauncherItem*> loadedItems;
     QStack<LauncherFolderItem*> menus;
     QString textData;
     int loadedCount = 0;
@@ -590,15 +719,12 @@ void LauncherFolderModel::load()
                 }
             } else if (xml.name() == QLatin1String("Filename")) {
                 if (!menus.isEmpty()) {
-                    int idx = mLauncherModel->indexInModel(textData);
-                    if (idx >= 0) {
-                        loadedItems[idx] = true;
-                        LauncherItem *item = qobject_cast<LauncherItem*>(mLauncherModel->get(idx));
-                        if (item) {
-                            loadedCount++;
-                            LauncherFolderItem *folder = menus.top();
-                            folder->addItem(item);
-                        }
+                    LauncherItem *item = mLauncherModel->itemInModel(textData);
+                    if (item) {
+                        loadedItems.insert(item);
+                        loadedCount++;
+                        LauncherFolderItem *folder = menus.top();
+                        folder->addItem(item);
                     }
                 }
             }
@@ -608,9 +734,9 @@ void LauncherFolderModel::load()
         }
     }
 
-    for (int i = 0; i < loadedItems.count(); ++i) {
-        if (!loadedItems.at(i)) {
-            addItem(mLauncherModel->get(i));
+    foreach (LauncherItem *item, *mLauncherModel->getList<LauncherItem>()) {
+        if (!loadedItems.contains(item)) {
+            addItem(item);
         }
     }
 
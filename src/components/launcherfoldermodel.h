@@ -27,7 +27,6 @@
 #include "lipstickglobal.h"
 
 class LauncherModel;
-class QXmlStreamWriter;
 class MDesktopEntry;
 class LauncherItem;
 
@@ -99,6 +98,7 @@ class LIPSTICK_EXPORT LauncherFolderModel : public LauncherFolderItem
     Q_PROPERTY(QStringList categories READ categories WRITE setCategories NOTIFY categoriesChanged)
 public:
     LauncherFolderModel(QObject *parent = 0);
+    virtual ~LauncherFolderModel();
 
     QString scope() const;
     void setScope(const QString &scope);
@@ -144,9 +144,10 @@ private slots:
     void appAdded(QObject *item);
 
 private:
-    void saveFolder(QXmlStreamWriter &xml, LauncherFolderItem *folder);
+    class MenuWriter;
 
     DeferredLauncherModel *mLauncherModel;
+    MenuWriter *mMenuWriter;
     QTimer mSaveTimer;
     bool mLoading;
     bool mInitialized;
@@ -31,6 +31,26 @@
 
 #include "launcheritem.h"
 #include "launchermodel.h"
+#include "launcherentrycache.h"
+
+static QString fileIDFromPath(const QString &filePath, const QString &filename)
+{
+    if (filePath.isEmpty()) {
+        return QString();
+    }
+
+    // Retrieve the file ID according to
+    // http://standards.freedesktop.org/desktop-entry-spec/latest/ape.html
+    static const QRegularExpression re(".*applications/(.*.desktop)");
+    QRegularExpressionMatch match = re.match(filePath);
+    if (!match.hasMatch()) {
+        return filename;
+    }
+
+    QString id = match.captured(1);
+    id.replace('/', '-');
+    return id;
+}
 
 LauncherItem::LauncherItem(const QString &filePath, QObject *parent)
     : QObject(parent)
@@ -79,52 +99,41 @@ LauncherModel::ItemType LauncherItem::type() const
 
 void LauncherItem::setFilePath(const QString &filePath)
 {
+    _desktopEntry.clear();
     if (!filePath.isEmpty() && QFile(filePath).exists()) {
-        _desktopEntry = QSharedPointer<MDesktopEntry>(new MDesktopEntry(filePath));
+        _filePath = filePath;
+        _entry = LauncherEntryCache::instance()->entry(filePath);
     } else {
-        _desktopEntry.clear();
+        _filePath.clear();
+        _entry.clear();
     }
 
+    // The file name and ID only change with the path, so they are resolved here once
+    int sep = _filePath.lastIndexOf('/');
+    _filename = sep != -1 ? _filePath.mid(sep + 1) : QString();
+    _fileID = fileIDFromPath(_filePath, _filename);
+
     emit this->itemChanged();
 }
 
 QString LauncherItem::filePath() const
 {
-    return !_desktopEntry.isNull() ? _desktopEntry->fileName() : QString();
+    return _filePath;
 }
 
 QString LauncherItem::fileID() const
 {
-    if (_desktopEntry.isNull()) {
-        return QString();
-    }
-
-    // Retrieve the file ID according to
-    // http://standards.freedesktop.org/desktop-entry-spec/latest/ape.html
-    QRegularExpression re(".*applications/(.*.desktop)");
-    QRegularExpressionMatch match = re.match(_desktopEntry->fileName());
-    if (!match.hasMatch()) {
-        return filename();
-    }
-
-    QString id = match.captured(1);
-    id.replace('/', '-');
-    return id;
+    return _fileID;
 }
 
 QString LauncherItem::filename() const
 {
-    QString filename = filePath();
-    int sep = filename.lastIndexOf('/');
-    if (sep == -1)
-        return QString();
-
-    return filename.mid(sep+1);
+    return _filename;
 }
 
 QString LauncherItem::exec() const
 {
-    return !_desktopEntry.isNull() ? _desktopEntry->exec() : QString();
+    return !_entry.isNull() ? _entry->exec : QString();
 }
 
 QString LauncherItem::title() const
@@ -133,12 +142,12 @@ QString LauncherItem::title() const
         return _customTitle;
     }
 
-    return !_desktopEntry.isNull() ? _desktopEntry->name() : QString();
+    return !_entry.isNull() ? _entry->name : QString();
 }
 
 QString LauncherItem::entryType() const
 {
-    return !_desktopEntry.isNull() ? _desktopEntry->type() : QString();
+    return !_entry.isNull() ? _entry->type : QString();
 }
 
 QString LauncherItem::iconId() const
@@ -152,7 +161,7 @@ QString LauncherItem::iconId() const
 
 QStringList LauncherItem::desktopCategories() const
 {
-    return !_desktopEntry.isNull() ? _desktopEntry->categories() : QStringList();
+    return !_entry.isNull() ? _entry->categories : QStringList();
 }
 
 QString LauncherItem::titleUnlocalized() const
@@ -161,17 +170,17 @@ QString LauncherItem::titleUnlocalized() const
         return _customTitle;
     }
 
-    return !_desktopEntry.isNull() ? _desktopEntry->nameUnlocalized() : QString();
+    return !_entry.isNull() ? _entry->nameUnlocalized : QString();
 }
 
 bool LauncherItem::shouldDisplay() const
 {
-    return !_desktopEntry.isNull() ? !_desktopEntry->noDisplay() : _isTemporary;
+    return !_entry.isNull() ? !_entry->noDisplay : _isTemporary;
 }
 
 bool LauncherItem::isValid() const
 {
-    return !_desktopEntry.isNull() ? _desktopEntry->isValid() : _isTemporary;
+    return !_entry.isNull() ? _entry->isValid : _isTemporary;
 }
 
 bool LauncherItem::isLaunching() const
@@ -217,27 +226,27 @@ void LauncherItem::launchApplication()
         return;
     }
 
-    if (_desktopEntry.isNull())
+    if (_entry.isNull())
         return;
 
 #if defined(HAVE_CONTENTACTION)
-    LAUNCHER_DEBUG("launching content action for" << _desktopEntry->name());
-    ContentAction::Action action = ContentAction::Action::launcherAction(_desktopEntry, QStringList());
+    LAUNCHER_DEBUG("launching content action for" << _entry->name);
+    ContentAction::Action action = ContentAction::Action::launcherAction(desktopEntry(), QStringList());
     action.trigger();
 #else
-    LAUNCHER_DEBUG("launching exec line for" << _desktopEntry->name());
+    LAUNCHER_DEBUG("launching exec line for" << _entry->name);
 
     // Get the command text from the desktop entry
-    QString commandText = _desktopEntry->exec();
+    QString commandText = _entry->exec;
 
     // Take care of the freedesktop standards things
 
     commandText.replace(QRegExp("%k"), filePath());
-    commandText.replace(QRegExp("%c"), _desktopEntry->name());
+    commandText.replace(QRegExp("%c"), _entry->name);
     commandText.remove(QRegExp("%[fFuU]"));
 
-    if (!_desktopEntry->icon().isEmpty())
-        commandText.replace(QRegExp("%i"), QString("--icon ") + _desktopEntry->icon());
+    if (!_entry->icon.isEmpty())
+        commandText.replace(QRegExp("%i"), QString("--icon ") + _entry->icon);
 
     // DETAILS: http://standards.freedesktop.org/desktop-entry-spec/latest/index.html
     // DETAILS: http://standards.freedesktop.org/desktop-entry-spec/latest/ar01s06.html
@@ -255,14 +264,15 @@ bool LauncherItem::isStillValid()
         return true;
     }
 
-    // Force a reload of _desktopEntry
+    // Force a reload of the desktop entry
+    LauncherEntryCache::instance()->remove(_filePath);
     setFilePath(filePath());
     return isValid();
 }
 
 QString LauncherItem::getOriginalIconId() const
 {
-    return !_desktopEntry.isNull() ? _desktopEntry->icon() : QString();
+    return !_entry.isNull() ? _entry->icon : QString();
 }
 
 void LauncherItem::setIconFilename(const QString &path)
@@ -305,10 +315,19 @@ void LauncherItem::setCustomTitle(QString customTitle)
 
 QString LauncherItem::readValue(const QString &key) const
 {
-    if (_desktopEntry.isNull())
+    if (_entry.isNull())
         return QString();
 
-    return _desktopEntry->value("Desktop Entry", key);
+    return desktopEntry()->value("Desktop Entry", key);
+}
+
+QSharedPointer<MDesktopEntry> LauncherItem::desktopEntry() const
+{
+    // The full desktop entry is only parsed when something not in the cached entry is needed
+    if (_desktopEntry.isNull() && !_filePath.isEmpty()) {
+        _desktopEntry = QSharedPointer<MDesktopEntry>(new MDesktopEntry(_filePath));
+    }
+    return _desktopEntry;
 }
 
 void LauncherItem::timerEvent(QTimerEvent *event)
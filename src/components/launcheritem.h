@@ -35,6 +35,7 @@
 #include "lipstickglobal.h"
 
 class MDesktopEntry;
+struct LauncherEntry;
 
 class LIPSTICK_EXPORT LauncherItem : public QObject
 {
@@ -58,7 +59,11 @@ class LIPSTICK_EXPORT LauncherItem : public QObject
     Q_PROPERTY(QString packageName READ packageName WRITE setPackageName NOTIFY packageNameChanged)
     Q_PROPERTY(int updatingProgress READ updatingProgress WRITE setUpdatingProgress NOTIFY updatingProgressChanged)
 
-    QSharedPointer<MDesktopEntry> _desktopEntry;
+    QString _filePath;
+    QString _fileID;
+    QString _filename;
+    QSharedPointer<const LauncherEntry> _entry;
+    mutable QSharedPointer<MDesktopEntry> _desktopEntry;
     QBasicTimer _launchingTimeout;
     bool _isLaunching;
     bool _isUpdating;
@@ -126,6 +131,9 @@ signals:
 
 protected:
     void timerEvent(QTimerEvent *event);
+
+private:
+    QSharedPointer<MDesktopEntry> desktopEntry() const;
 };
 
 #endif // LAUNCHERITEM_H
@@ -15,15 +15,20 @@
 // Copyright (c) 2012, Timur Kristóf <venemo@fedoraproject.org>
 
 #include <QDir>
-#include <QFileSystemWatcher>
 #include <QDBusConnection>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
 #include <QSettings>
 #include <QStandardPaths>
+#include <QVector>
+#include <algorithm>
 
 #include "launcheritem.h"
 #include "launchermodel.h"
+#include "launcherentrycache.h"
+#include "launcherpositionstore.h"
+#include "directorywatcher.h"
 
 
 #define LAUNCHER_APPS_PATH "/usr/share/applications/"
@@ -96,8 +101,8 @@ LauncherModel::LauncherModel(QObject *parent) :
     QObjectListModel(parent),
     _directories(defaultDirectories()),
     _iconDirectories(LAUNCHER_ICONS_PATH),
-    _fileSystemWatcher(),
     _launcherSettings("nemomobile", "lipstick"),
+    _positionStore(0),
     _globalSettings("/usr/share/lipstick/lipstick.conf", QSettings::IniFormat),
     _launcherOrderPrefix(QStringLiteral("LauncherOrder/")),
     _dbusWatcher(this),
@@ -105,6 +110,11 @@ LauncherModel::LauncherModel(QObject *parent) :
     _temporaryLaunchers(),
     _initialized(false)
 {
+    connect(this, SIGNAL(itemAdded(QObject*)), this, SLOT(onItemAdded(QObject*)));
+    connect(this, SIGNAL(itemRemoved(QObject*)), this, SLOT(onItemRemoved(QObject*)));
+    connect(this, SIGNAL(modelReset()), this, SLOT(rebuildItemIndexes()));
+    _positionStore = new LauncherPositionStore(positionStorePath());
+
     initialize();
 }
 
@@ -112,8 +122,8 @@ LauncherModel::LauncherModel(InitializationMode, QObject *parent) :
     QObjectListModel(parent),
     _directories(defaultDirectories()),
     _iconDirectories(LAUNCHER_ICONS_PATH),
-    _fileSystemWatcher(),
     _launcherSettings("nemomobile", "lipstick"),
+    _positionStore(0),
     _globalSettings("/usr/share/lipstick/lipstick.conf", QSettings::IniFormat),
     _launcherOrderPrefix(QStringLiteral("LauncherOrder/")),
     _dbusWatcher(this),
@@ -121,6 +131,10 @@ LauncherModel::LauncherModel(InitializationMode, QObject *parent) :
     _temporaryLaunchers(),
     _initialized(false)
 {
+    connect(this, SIGNAL(itemAdded(QObject*)), this, SLOT(onItemAdded(QObject*)));
+    connect(this, SIGNAL(itemRemoved(QObject*)), this, SLOT(onItemRemoved(QObject*)));
+    connect(this, SIGNAL(modelReset()), this, SLOT(rebuildItemIndexes()));
+    _positionStore = new LauncherPositionStore(positionStorePath());
 }
 
 void LauncherModel::initialize()
@@ -149,8 +163,9 @@ void LauncherModel::initialize()
     connect(this, SIGNAL(rowsMoved(const QModelIndex&,int,int,const QModelIndex&,int)), this, SLOT(savePositions()));
 
     // Watch for changes to the item order settings file
-    _fileSystemWatcher.addPath(_launcherSettings.fileName());
-    connect(&_fileSystemWatcher, SIGNAL(fileChanged(QString)), this, SLOT(monitoredFileChanged(QString)));
+    DirectoryWatcher::instance()->addDirectory(QFileInfo(_launcherSettings.fileName()).absolutePath());
+    connect(DirectoryWatcher::instance(), SIGNAL(filesChanged(QString,QStringList,QStringList,QStringList)),
+            this, SLOT(monitoredFilesChanged(QString,QStringList,QStringList,QStringList)));
 
     // Used to watch for owner changes during installation progress
     _dbusWatcher.setConnection(QDBusConnection::sessionBus());
@@ -163,6 +178,10 @@ void LauncherModel::initialize()
 LauncherModel::~LauncherModel()
 {
     _launcherDBus()->deregisterModel(this);
+    delete _positionStore;
+
+    if (_initialized)
+        DirectoryWatcher::instance()->removeDirectory(QFileInfo(_launcherSettings.fileName()).absolutePath());
 }
 
 void LauncherModel::onFilesUpdated(const QStringList &added,
@@ -170,15 +189,33 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
 {
     QStringList modifiedAndNeedUpdating = modified;
 
+    // The items are added to and removed from a copy of the list, which is
+    // applied to the model in one go once the update is complete. The item
+    // indexes are kept up to date with the copy, so items can be looked up
+    // as before.
+    QList<LauncherItem *> items = *getList<LauncherItem>();
+
+    // Keep track of the icon files, so that the icons of new items can be
+    // looked up without checking the icon directories
+    foreach (const QString &filename, removed) {
+        if (isIconFile(filename))
+            _iconFiles.remove(filename);
+    }
+    foreach (const QString &filename, added) {
+        if (isIconFile(filename))
+            _iconFiles.insert(filename);
+    }
+
     // First, remove all removed launcher items before adding new ones
     foreach (const QString &filename, removed) {
         if (isDesktopFile(_directories, filename)) {
             // Desktop file has been removed - remove launcher
+            LauncherEntryCache::instance()->remove(filename);
             LauncherItem *item = itemInModel(filename);
             if (item != NULL) {
                 LAUNCHER_DEBUG("Removing launcher item:" << filename);
                 unsetTemporary(item);
-                removeItem(item);
+                removeListItem(item, &items);
             }
         } else if (isIconFile(filename)) {
             // Icons has been removed - find item and clear its icon path
@@ -186,6 +223,15 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
         }
     }
 
+    // Parse the desktop files of new launcher items in parallel, so that
+    // creating the items below doesn't need to parse them one by one
+    QStringList newDesktopFiles;
+    foreach (const QString &filename, added) {
+        if (isDesktopFile(_directories, filename) && itemInModel(filename) == NULL)
+            newDesktopFiles.append(filename);
+    }
+    LauncherEntryCache::instance()->prefetch(newDesktopFiles);
+
     foreach (const QString &filename, added) {
         if (isDesktopFile(_directories, filename)) {
             // New desktop file appeared - add launcher
@@ -211,13 +257,13 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
 
             if (item == NULL) {
                 LAUNCHER_DEBUG("Trying to add launcher item:" << filename);
-                item = addItemIfValid(filename);
+                item = addItemIfValid(filename, &items);
 
                 if (item != NULL) {
                     // Try to look up an already-installed icon in the icons directory
                     foreach (const QString &iconPath, _launcherMonitor.iconDirectories()) {
                         QString iconname = filenameFromIconId(item->getOriginalIconId(), iconPath);
-                        if (QFile(iconname).exists()) {
+                        if (_iconFiles.contains(iconname)) {
                             LAUNCHER_DEBUG("Loading existing icon:" << iconname);
                             updateItemsWithIcon(iconname, true);
                             break;
@@ -251,7 +297,7 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
                     // File has changed in such a way (e.g. Hidden=true) that
                     // it now should become invisible again
                     unsetTemporary(item);
-                    removeItem(item);
+                    removeListItem(item, &items);
                 } else {
                     // File has been updated and is still valid; check if we
                     // might need to auto-update the icon file
@@ -259,7 +305,7 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
                         foreach (const QString &iconPath, _launcherMonitor.iconDirectories()) {
                             QString filename = filenameFromIconId(item->getOriginalIconId(), iconPath);
                             LAUNCHER_DEBUG("Desktop file changed, checking for:" << filename);
-                            if (QFile(filename).exists()) {
+                            if (_iconFiles.contains(filename)) {
                                 updateItemsWithIcon(filename, true);
                                 break;
                             }
@@ -269,7 +315,7 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
             } else {
                 // No item yet (maybe it had Hidden=true before), try to see if
                 // we should show the item now
-                addItemIfValid(filename);
+                addItemIfValid(filename, &items);
             }
         } else if (isIconFile(filename)) {
             // Icons has been updated - find item and update its icon path
@@ -277,8 +323,18 @@ void LauncherModel::onFilesUpdated(const QStringList &added,
         }
     }
 
-    reorderItems();
+    // Apply the additions, removals and the new order as a single change
+    const QVector<int> order = sortedOrder(items);
+    QList<LauncherItem *> orderedItems;
+    orderedItems.reserve(order.count());
+    foreach (int index, order)
+        orderedItems.append(items.at(index));
+    synchronizeList(orderedItems);
+
     savePositions();
+
+    // Keep the parsed desktop entries for the next startup
+    LauncherEntryCache::instance()->save();
 }
 
 void LauncherModel::updateItemsWithIcon(const QString &filename, bool existing)
@@ -287,94 +343,181 @@ void LauncherModel::updateItemsWithIcon(const QString &filename, bool existing)
 
     LAUNCHER_DEBUG("updateItemsWithIcon: filename=" << filename << ", existing=" << existing << ", id=" << iconId);
 
-    foreach (LauncherItem *item, *getList<LauncherItem>()) {
-        const QString &currentId = item->getOriginalIconId();
-        if (currentId.isEmpty()) {
-            continue;
-        }
-
-        if (!existing && filename == item->iconFilename()) {
+    if (!existing) {
+        foreach (LauncherItem *item, _itemsByIconFilename.values(filename)) {
             // File is currently used as icon, but has been removed
             LAUNCHER_DEBUG("Icon vanished, removing:" << filename);
             item->setIconFilename("");
-        } else if (existing) {
-            if ((filename == currentId) /* absolute file path in .desktop file */ ||
-                    (iconId == currentId) /* icon id matches */) {
-                LAUNCHER_DEBUG("Icon was added or updated:" << filename);
-                item->setIconFilename(filename);
-            }
+        }
+    } else {
+        QList<LauncherItem *> items = _itemsByOriginalIconId.values(filename) /* absolute file path in .desktop file */;
+        if (!iconId.isEmpty() && iconId != filename)
+            items += _itemsByOriginalIconId.values(iconId) /* icon id matches */;
+
+        foreach (LauncherItem *item, items) {
+            LAUNCHER_DEBUG("Icon was added or updated:" << filename);
+            item->setIconFilename(filename);
         }
     }
 }
 
-void LauncherModel::monitoredFileChanged(const QString &changedPath)
+void LauncherModel::monitoredFilesChanged(const QString &directory, const QStringList &added,
+        const QStringList &modified, const QStringList &)
 {
-    if (changedPath == _launcherSettings.fileName()) {
-        loadPositions();
-    } else {
-        qWarning() << "Unknown monitored file in LauncherModel:" << changedPath;
+    const QFileInfo positionsFile(_positionStore->path());
+    if (directory != QDir::cleanPath(positionsFile.absolutePath()))
+        return;
+
+    const QString positionsPath = QDir::cleanPath(positionsFile.absoluteFilePath());
+    if (!added.contains(positionsPath) && !modified.contains(positionsPath))
+        return;
+
+    // The changes made by savePositions() itself are reported too, but they
+    // don't change the order known to the store
+    if (_positionStore->reload()) {
+        _launcherPositions.clear();
+        reorderItems();
     }
 }
 
 void LauncherModel::loadPositions()
 {
     _launcherSettings.sync();
+    _positionStore->reload();
+    _launcherPositions.clear();
     reorderItems();
 }
 
-void LauncherModel::reorderItems()
+QString LauncherModel::positionStorePath() const
 {
-    QMap<int, LauncherItem *> itemsWithPositions;
-    QMap<QString, LauncherItem *> itemsWithoutPositions;
-
-    QList<LauncherItem *> *currentLauncherList = getList<LauncherItem>();
-    foreach (LauncherItem *item, *currentLauncherList) {
-        QVariant pos = launcherPos(item->filePath());
+    // The positions are kept next to the settings, one file for each scope
+    QString path = QFileInfo(_launcherSettings.fileName()).absolutePath() + QStringLiteral("/launcherpositions");
+    if (!_scope.isEmpty())
+        path += QLatin1Char('-') + _scope;
+    return path + QStringLiteral(".dat");
+}
 
-        if (pos.isValid()) {
-            int gridPos = pos.toInt();
-            itemsWithPositions.insert(gridPos, item);
-        } else {
-            itemsWithoutPositions.insert(item->title(), item);
+// Returns which elements of the sequence belong to its longest increasing subsequence
+static QVector<bool> longestIncreasingSubsequence(const QVector<int> &sequence)
+{
+    const int count = sequence.count();
+
+    // The index of the last element of the best increasing subsequence of each length found so far
+    QVector<int> tails;
+    tails.reserve(count);
+    QVector<int> previous(count, -1);
+
+    for (int i = 0; i < count; ++i) {
+        int first = 0;
+        int last = tails.count();
+        while (first < last) {
+            const int middle = first + (last - first) / 2;
+            if (sequence.at(tails.at(middle)) < sequence.at(i)) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
         }
+
+        if (first > 0)
+            previous[i] = tails.at(first - 1);
+        if (first == tails.count())
+            tails.append(i);
+        else
+            tails[first] = i;
     }
 
-    QList<LauncherItem *> reordered;
-    {
-        // Order the positioned items into contiguous order
-        QMap<int, LauncherItem *>::const_iterator it = itemsWithPositions.constBegin(), end = itemsWithPositions.constEnd();
-        for ( ; it != end; ++it) {
-            LAUNCHER_DEBUG("Planned move of" << it.value()->title() << "to" << reordered.count());
-            reordered.append(it.value());
-        }
+    QVector<bool> members(count, false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = previous.at(i))
+        members[i] = true;
+    return members;
+}
+
+// Returns the indexes of the items in the order they should be in
+QVector<int> LauncherModel::sortedOrder(const QList<LauncherItem *> &items)
+{
+    struct Placement {
+        bool positioned;
+        int position;
+        QString title;
+        int currentIndex;
+    };
+
+    const int count = items.count();
+
+    QVector<Placement> placements(count);
+    for (int i = 0; i < count; ++i) {
+        LauncherItem *item = items.at(i);
+        QVariant pos = launcherPos(item->filePath());
+
+        Placement &placement(placements[i]);
+        placement.positioned = pos.isValid();
+        placement.position = placement.positioned ? pos.toInt() : 0;
+        if (!placement.positioned)
+            placement.title = item->title();
+        placement.currentIndex = i;
     }
-    {
-        // Append the un-positioned items in sorted-by-title order
-        QMap<QString, LauncherItem *>::const_iterator it = itemsWithoutPositions.constBegin(), end = itemsWithoutPositions.constEnd();
-        for ( ; it != end; ++it) {
-            LAUNCHER_DEBUG("Planned move of" << it.value()->title() << "to" << reordered.count());
-            reordered.append(it.value());
+
+    // Order the positioned items into contiguous order, followed by the
+    // un-positioned items in sorted-by-title order. Items with the same
+    // position or title keep their current order.
+    struct Comparator {
+        bool operator()(const Placement &lhs, const Placement &rhs) const {
+            if (lhs.positioned != rhs.positioned)
+                return lhs.positioned;
+            if (lhs.positioned && lhs.position != rhs.position)
+                return lhs.position < rhs.position;
+            if (!lhs.positioned && lhs.title != rhs.title)
+                return lhs.title < rhs.title;
+            return lhs.currentIndex < rhs.currentIndex;
         }
+    };
+    std::sort(placements.begin(), placements.end(), Comparator());
+
+    QVector<int> order(count);
+    for (int gridPos = 0; gridPos < count; ++gridPos)
+        order[gridPos] = placements.at(gridPos).currentIndex;
+    return order;
+}
+
+void LauncherModel::reorderItems()
+{
+    QList<LauncherItem *> *currentLauncherList = getList<LauncherItem>();
+    const int count = currentLauncherList->count();
+    const QVector<int> order = sortedOrder(*currentLauncherList);
+
+    QList<LauncherItem *> reordered;
+    reordered.reserve(count);
+    QVector<int> targetIndexes(count);
+    for (int gridPos = 0; gridPos < count; ++gridPos) {
+        const int currentIndex = order.at(gridPos);
+        LAUNCHER_DEBUG("Planned move of" << currentLauncherList->at(currentIndex)->title() << "to" << gridPos);
+        reordered.append(currentLauncherList->at(currentIndex));
+        targetIndexes[currentIndex] = gridPos;
     }
 
-    for (int gridPos = 0; gridPos < reordered.count(); ++gridPos) {
-        LauncherItem *item = reordered.at(gridPos);
-        LAUNCHER_DEBUG("Moving" << item->filePath() << "to" << gridPos);
+    // The items forming the longest increasing subsequence of target positions
+    // are already in the right order relative to each other, so only the
+    // other items need to be moved
+    const QVector<bool> inOrder = longestIncreasingSubsequence(targetIndexes);
 
-        if (gridPos < 0 || gridPos >= itemCount()) {
-            LAUNCHER_DEBUG("Invalid planned position for" << item->filePath());
+    for (int gridPos = 0; gridPos < count; ++gridPos) {
+        if (inOrder.at(order.at(gridPos)))
             continue;
-        }
 
+        // Place the item right after the item preceding it in the target
+        // order, which is already where it should be
+        LauncherItem *item = reordered.at(gridPos);
         int currentPos = indexOf(item);
-        Q_ASSERT(currentPos >= 0);
-        if (currentPos == -1)
-            continue;
-
-        if (gridPos == currentPos)
-            continue;
+        int newPos = 0;
+        if (gridPos > 0) {
+            int previousPos = indexOf(reordered.at(gridPos - 1));
+            newPos = currentPos > previousPos ? previousPos + 1 : previousPos;
+        }
 
-        move(currentPos, gridPos);
+        LAUNCHER_DEBUG("Moving" << item->filePath() << "to" << newPos);
+        if (currentPos != newPos)
+            move(currentPos, newPos);
     }
 }
 
@@ -461,6 +604,9 @@ void LauncherModel::setScope(const QString &scope)
         _launcherOrderPrefix = !_scope.isEmpty()
                 ? scope + QStringLiteral("/LauncherOrder/")
                 : QStringLiteral("LauncherOrder/");
+        _launcherPositions.clear();
+        delete _positionStore;
+        _positionStore = new LauncherPositionStore(positionStorePath());
         emit scopeChanged();
 
         if (_initialized) {
@@ -665,63 +811,168 @@ void LauncherModel::requestLaunch(const QString &packageName)
 
 void LauncherModel::savePositions()
 {
-    _fileSystemWatcher.removePath(_launcherSettings.fileName());
-
-    _launcherSettings.remove(_launcherOrderPrefix.left(_launcherOrderPrefix.count() - 1));
+    _launcherPositions.clear();
     QList<LauncherItem *> *currentLauncherList = getList<LauncherItem>();
 
-    int pos = 0;
+    QStringList order;
+    order.reserve(currentLauncherList->count());
     foreach (LauncherItem *item, *currentLauncherList) {
-        _launcherSettings.setValue(_launcherOrderPrefix + item->filePath(), pos);
-        ++pos;
+        _launcherPositions.insert(item->filePath(), order.count());
+        order.append(item->filePath());
     }
 
-    _launcherSettings.sync();
-    _fileSystemWatcher.addPath(_launcherSettings.fileName());
+    if (!_positionStore->hasPositions()) {
+        // The positions used to be stored in the settings. They are migrated
+        // to the position store by the first save, and removed from the
+        // settings only once the store has been written.
+        if (_positionStore->write(order)) {
+            _launcherSettings.remove(_launcherOrderPrefix.left(_launcherOrderPrefix.count() - 1));
+            _launcherSettings.sync();
+        }
+        return;
+    }
+
+    // Only written if the order has changed since the previous save
+    _positionStore->save(order);
 }
 
-int LauncherModel::findItem(const QString &path, LauncherItem **item)
+void LauncherModel::onItemAdded(QObject *object)
 {
-    QList<LauncherItem*> *list = getList<LauncherItem>();
-    for (int i = 0; i < list->count(); ++i) {
-        LauncherItem *listItem = list->at(i);
-        if (listItem->filePath() == path || listItem->filename() == path) {
-            if (item)
-                *item = listItem;
-            return i;
-        }
+    LauncherItem *item = qobject_cast<LauncherItem *>(object);
+    if (item == NULL)
+        return;
+
+    // The file path changes with itemChanged()
+    connect(item, SIGNAL(itemChanged()), this, SLOT(onItemChanged()), Qt::UniqueConnection);
+    connect(item, SIGNAL(packageNameChanged()), this, SLOT(onItemChanged()), Qt::UniqueConnection);
+
+    // Items added by a file update have been indexed before they were added to the model
+    if (!_itemKeys.contains(item))
+        indexItem(item);
+}
+
+void LauncherModel::onItemRemoved(QObject *item)
+{
+    // The item may be being destroyed, so it's only used as a key
+    disconnect(item, 0, this, SLOT(onItemChanged()));
+    unindexItem(item);
+}
+
+void LauncherModel::onItemChanged()
+{
+    QObject *object = sender();
+    QHash<QObject *, ItemKeys>::const_iterator it = _itemKeys.constFind(object);
+    if (it == _itemKeys.constEnd())
+        return;
+
+    LauncherItem *item = it->item;
+    if (it->filePath != item->filePath() || it->packageName != item->packageName() ||
+            it->originalIconId != item->getOriginalIconId() || it->iconFilename != item->iconFilename()) {
+        unindexItem(object);
+        indexItem(item);
     }
+}
 
-    if (item)
-        *item = 0;
+void LauncherModel::rebuildItemIndexes()
+{
+    _itemKeys.clear();
+    _itemsByFilePath.clear();
+    _itemsByFilename.clear();
+    _itemsByPackageName.clear();
+    _itemsByOriginalIconId.clear();
+    _itemsByIconFilename.clear();
+
+    foreach (LauncherItem *item, *getList<LauncherItem>())
+        onItemAdded(item);
+}
 
-    return -1;
+void LauncherModel::indexItem(LauncherItem *item)
+{
+    ItemKeys keys;
+    keys.item = item;
+    keys.filePath = item->filePath();
+    keys.filename = item->filename();
+    keys.packageName = item->packageName();
+    keys.originalIconId = item->getOriginalIconId();
+    keys.iconFilename = item->iconFilename();
+
+    _itemsByFilePath.insert(keys.filePath, item);
+    _itemsByFilename.insert(keys.filename, item);
+    _itemsByPackageName.insert(keys.packageName, item);
+    // Items without an icon id never get icons from the icon directories
+    if (!keys.originalIconId.isEmpty()) {
+        _itemsByOriginalIconId.insert(keys.originalIconId, item);
+        _itemsByIconFilename.insert(keys.iconFilename, item);
+    }
+    _itemKeys.insert(item, keys);
 }
 
-LauncherItem *LauncherModel::itemInModel(const QString &path)
+void LauncherModel::unindexItem(QObject *item)
 {
+    QHash<QObject *, ItemKeys>::iterator it = _itemKeys.find(item);
+    if (it == _itemKeys.end())
+        return;
+
+    _itemsByFilePath.remove(it->filePath, it->item);
+    _itemsByFilename.remove(it->filename, it->item);
+    _itemsByPackageName.remove(it->packageName, it->item);
+    _itemsByOriginalIconId.remove(it->originalIconId, it->item);
+    _itemsByIconFilename.remove(it->iconFilename, it->item);
+    _itemKeys.erase(it);
+}
+
+LauncherItem *LauncherModel::selectItem(const QList<LauncherItem *> &candidates, bool last, int *index)
+{
+    if (candidates.isEmpty()) {
+        if (index)
+            *index = -1;
+        return 0;
+    }
+
+    if (candidates.count() == 1 && !index)
+        return candidates.first();
+
+    // Several items share the key, pick the first or the last one in the model
     LauncherItem *result = 0;
-    (void)findItem(path, &result);
+    int resultIndex = -1;
+    foreach (LauncherItem *candidate, candidates) {
+        int candidateIndex = indexOf(candidate);
+        if (resultIndex == -1 || (last ? candidateIndex > resultIndex : candidateIndex < resultIndex)) {
+            result = candidate;
+            resultIndex = candidateIndex;
+        }
+    }
+
+    if (index)
+        *index = resultIndex;
     return result;
 }
 
-int LauncherModel::indexInModel(const QString &path)
+LauncherItem *LauncherModel::findItem(const QString &path, int *index)
 {
-    return findItem(path, 0);
+    // Items are looked up both by their full path and by their file name
+    QList<LauncherItem *> candidates = _itemsByFilePath.values(path);
+    candidates += _itemsByFilename.values(path);
+    return selectItem(candidates, false, index);
 }
 
-LauncherItem *LauncherModel::packageInModel(const QString &packageName)
+LauncherItem *LauncherModel::itemInModel(const QString &path)
 {
-    QList<LauncherItem *> *list = getList<LauncherItem>();
+    return findItem(path);
+}
 
-    QList<LauncherItem *>::const_iterator it = list->constEnd();
-    while (it != list->constBegin()) {
-        --it;
+int LauncherModel::indexInModel(const QString &path)
+{
+    int index = -1;
+    (void)findItem(path, &index);
+    return index;
+}
 
-        if ((*it)->packageName() == packageName) {
-            return *it;
-        }
-    }
+LauncherItem *LauncherModel::packageInModel(const QString &packageName)
+{
+    LauncherItem *item = selectItem(_itemsByPackageName.values(packageName), true, 0);
+    if (item)
+        return item;
 
     // Fall back to trying to find the launcher via the .desktop file
     return itemInModel(desktopFileFromPackageName(_directories, packageName));
@@ -729,17 +980,30 @@ LauncherItem *LauncherModel::packageInModel(const QString &packageName)
 
 QVariant LauncherModel::launcherPos(const QString &path)
 {
+    QHash<QString, QVariant>::const_iterator it = _launcherPositions.constFind(path);
+    if (it != _launcherPositions.constEnd()) {
+        return it.value();
+    }
+
     QString key = _launcherOrderPrefix + path;
 
-    if (_launcherSettings.contains(key)) {
-        return _launcherSettings.value(key);
+    QVariant pos;
+    int storedPos = _positionStore->position(path);
+    if (storedPos >= 0) {
+        pos = storedPos;
+    } else if (!_positionStore->hasPositions() && _launcherSettings.contains(key)) {
+        // The positions have not been migrated from the settings yet
+        pos = _launcherSettings.value(key);
+    } else {
+        // fall back to vendor configuration if the user hasn't specified a location
+        pos = _globalSettings.value(key);
     }
 
-    // fall back to vendor configuration if the user hasn't specified a location
-    return _globalSettings.value(key);
+    _launcherPositions.insert(path, pos);
+    return pos;
 }
 
-LauncherItem *LauncherModel::addItemIfValid(const QString &path)
+LauncherItem *LauncherModel::addItemIfValid(const QString &path, QList<LauncherItem *> *items)
 {
     LAUNCHER_DEBUG("Creating LauncherItem for desktop entry" << path);
     LauncherItem *item = new LauncherItem(path, this);
@@ -753,7 +1017,9 @@ LauncherItem *LauncherModel::addItemIfValid(const QString &path)
         }
     }
     if (isValid && shouldDisplay) {
-        addItem(item);
+        // The item is added to the model with the list, but it can be looked up already
+        items->append(item);
+        onItemAdded(item);
     } else {
         LAUNCHER_DEBUG("Item" << path << (!isValid ? "is not valid" : "should not be displayed"));
         delete item;
@@ -763,6 +1029,13 @@ LauncherItem *LauncherModel::addItemIfValid(const QString &path)
     return item;
 }
 
+void LauncherModel::removeListItem(LauncherItem *item, QList<LauncherItem *> *items)
+{
+    // The item is removed from the model with the list, but it can't be looked up anymore
+    items->removeOne(item);
+    onItemRemoved(item);
+}
+
 void LauncherModel::setTemporary(LauncherItem *item)
 {
     if (!item->isTemporary()) {
@@ -19,9 +19,11 @@
 
 #include <QObject>
 #include <QSettings>
-#include <QFileSystemWatcher>
 #include <QDBusServiceWatcher>
+#include <QHash>
 #include <QMap>
+#include <QSet>
+#include <QVector>
 
 #include "qobjectlistmodel.h"
 #include "lipstickglobal.h"
@@ -29,6 +31,7 @@
 #include "launcherdbus.h"
 
 class LauncherItem;
+class LauncherPositionStore;
 
 class LIPSTICK_EXPORT LauncherModel : public QObjectListModel
 {
@@ -45,8 +48,10 @@ class LIPSTICK_EXPORT LauncherModel : public QObjectListModel
     QStringList _directories;
     QStringList _iconDirectories;
     QStringList _categories;
-    QFileSystemWatcher _fileSystemWatcher;
     QSettings _launcherSettings;
+    LauncherPositionStore *_positionStore;
+    // Item positions read from the position store or the settings, keyed by file path
+    QHash<QString, QVariant> _launcherPositions;
     QSettings _globalSettings;
     LauncherMonitor _launcherMonitor;
     QString _scope;
@@ -57,8 +62,31 @@ class LIPSTICK_EXPORT LauncherModel : public QObjectListModel
     QList<LauncherItem *> _temporaryLaunchers;
     bool _initialized;
 
+    // The keys an item is indexed with, kept so that destroyed items can be unindexed
+    struct ItemKeys {
+        LauncherItem *item;
+        QString filePath;
+        QString filename;
+        QString packageName;
+        QString originalIconId;
+        QString iconFilename;
+    };
+    QHash<QObject *, ItemKeys> _itemKeys;
+    QMultiHash<QString, LauncherItem *> _itemsByFilePath;
+    QMultiHash<QString, LauncherItem *> _itemsByFilename;
+    QMultiHash<QString, LauncherItem *> _itemsByPackageName;
+    QMultiHash<QString, LauncherItem *> _itemsByOriginalIconId;
+    QMultiHash<QString, LauncherItem *> _itemsByIconFilename;
+
+    // The icon files known to exist in the monitored icon directories
+    QSet<QString> _iconFiles;
+
 private slots:
-    void monitoredFileChanged(const QString &changedPath);
+    void onItemAdded(QObject *item);
+    void onItemRemoved(QObject *item);
+    void onItemChanged();
+    void rebuildItemIndexes();
+    void monitoredFilesChanged(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
     void onFilesUpdated(const QStringList &added, const QStringList &modified, const QStringList &removed);
     void onServiceUnregistered(const QString &serviceName);
 
@@ -114,12 +142,18 @@ protected:
     void initialize();
 
 private:
+    QVector<int> sortedOrder(const QList<LauncherItem *> &items);
     void reorderItems();
     void loadPositions();
-    int findItem(const QString &path, LauncherItem **item);
+    QString positionStorePath() const;
+    void indexItem(LauncherItem *item);
+    void unindexItem(QObject *item);
+    LauncherItem *findItem(const QString &path, int *index = 0);
+    LauncherItem *selectItem(const QList<LauncherItem *> &candidates, bool last, int *index);
     LauncherItem *packageInModel(const QString &packageName);
     QVariant launcherPos(const QString &path);
-    LauncherItem *addItemIfValid(const QString &path);
+    LauncherItem *addItemIfValid(const QString &path, QList<LauncherItem *> *items);
+    void removeListItem(LauncherItem *item, QList<LauncherItem *> *items);
     void updateItemsWithIcon(const QString &filename, bool existing);
     void updateWatchedDBusServices();
     void setTemporary(LauncherItem *item);
@@ -18,8 +18,10 @@
 #include "launchermonitor.h"
 
 #include "launcheritem.h"
+#include "directorywatcher.h"
 
 #include <QDir>
+#include <QFileInfo>
 
 /**
  * Timeout (in milliseconds) to hold back sending updates, so that we can
@@ -31,7 +33,6 @@
 
 LauncherMonitor::LauncherMonitor()
     : QObject()
-    , m_watcher()
     , m_holdbackTimer()
     , m_knownFiles()
     , m_addedFiles()
@@ -44,7 +45,6 @@ LauncherMonitor::LauncherMonitor()
 LauncherMonitor::LauncherMonitor(const QString &desktopFilesPath,
         const QString &iconFilesPath)
     : QObject()
-    , m_watcher()
     , m_holdbackTimer()
     , m_knownFiles()
     , m_addedFiles()
@@ -56,8 +56,8 @@ LauncherMonitor::LauncherMonitor(const QString &desktopFilesPath,
     m_iconFilesPaths << iconFilesPath;
     m_desktopFilesPaths << desktopFilesPath;
 
-    m_watcher.addPaths(m_iconFilesPaths);
-    m_watcher.addPaths(m_desktopFilesPaths);
+    DirectoryWatcher::instance()->addDirectory(iconFilesPath);
+    DirectoryWatcher::instance()->addDirectory(desktopFilesPath);
 
     // Force initial scan of directories
     // Scan the desktop files first, so that the launcher items are already
@@ -70,16 +70,19 @@ void LauncherMonitor::initialize()
 {
     m_holdbackTimer.setSingleShot(true);
 
-    QObject::connect(&m_watcher, SIGNAL(directoryChanged(const QString &)),
-            this, SLOT(onDirectoryChanged(const QString &)));
-    QObject::connect(&m_watcher, SIGNAL(fileChanged(const QString &)),
-            this, SLOT(onFileChanged(const QString &)));
+    DirectoryWatcher *watcher = DirectoryWatcher::instance();
+    QObject::connect(watcher, SIGNAL(filesChanged(const QString &, const QStringList &, const QStringList &, const QStringList &)),
+            this, SLOT(onFilesChanged(const QString &, const QStringList &, const QStringList &, const QStringList &)));
+    QObject::connect(watcher, SIGNAL(eventsLost()),
+            this, SLOT(onEventsLost()));
     QObject::connect(&m_holdbackTimer, SIGNAL(timeout()),
             this, SLOT(onHoldbackTimerTimeout()));
 }
 
 LauncherMonitor::~LauncherMonitor()
 {
+    foreach (const QString &path, m_desktopFilesPaths + m_iconFilesPaths)
+        DirectoryWatcher::instance()->removeDirectory(path);
 }
 
 void LauncherMonitor::start()
@@ -123,12 +126,12 @@ void LauncherMonitor::setDirectories(const QStringList &newDirs, QStringList &ta
         ++it;
     }
 
-    if (!targetDirs.isEmpty()) {
-        m_watcher.removePaths(targetDirs);
-    }
+    foreach (const QString &path, targetDirs)
+        DirectoryWatcher::instance()->removeDirectory(path);
 
     targetDirs = newDirs;
-    m_watcher.addPaths(newPaths);
+    foreach (const QString &path, newPaths)
+        DirectoryWatcher::instance()->addDirectory(path);
     foreach (QString path, newPaths)
         onDirectoryChanged(path);
 }
@@ -136,11 +139,12 @@ void LauncherMonitor::setDirectories(const QStringList &newDirs, QStringList &ta
 void LauncherMonitor::onDirectoryChanged(const QString &path)
 {
     QDir dir(path);
-    QStringList seen = dir.entryList();
+    const QStringList seenList = dir.entryList();
+    const QSet<QString> seen = seenList.toSet();
     QStringList added;
     QStringList removed;
-    QStringList &knownFiles = m_knownFiles[path];
-    
+    QSet<QString> &knownFiles = m_knownFiles[path];
+
     // Calculate added and removed files
     foreach (const QString &filename, knownFiles) {
         if (filename.startsWith(".")) {
@@ -151,7 +155,10 @@ void LauncherMonitor::onDirectoryChanged(const QString &path)
             removed.append(dir.filePath(filename));
         }
     }
-    foreach (const QString &filename, seen) {
+    // Keep the order independent of the order of the known files
+    removed.sort();
+
+    foreach (const QString &filename, seenList) {
         if (filename.startsWith(".")) {
             continue;
         }
@@ -161,65 +168,105 @@ void LauncherMonitor::onDirectoryChanged(const QString &path)
         }
     }
 
-    // First, stop monitoring all removed files and then tell interested
-    // parties that these files have gone.
-    // After that, do the same thing for added files.
-    if (!removed.isEmpty()) {
-        m_watcher.removePaths(removed);
-
-        foreach (const QString &filename, removed) {
-            m_modifiedFiles.removeAll(filename);
-            if (m_addedFiles.contains(filename)) {
-                // We have an "added" notification that's not sent out yet
-                // Just remove this notification, as if nothing happened
-                //
-                // (=> the file has been added and quickly removed again)
-                m_addedFiles.removeAll(filename);
-            } else {
-                m_removedFiles.append(filename);
-            }
+    // First tell interested parties that the removed files have gone,
+    // after that do the same thing for added files.
+    foreach (const QString &filename, removed)
+        removeFile(filename);
+    foreach (const QString &filename, added)
+        addFile(filename);
+
+    // Schedule updating the launcher icons
+    m_holdbackTimer.start(LAUNCHER_MONITOR_HOLDBACK_TIMEOUT_MS);
+
+    knownFiles = seen;
+}
+
+void LauncherMonitor::onFilesChanged(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed)
+{
+    QSet<QString> *knownFiles = 0;
+    foreach (const QString &path, m_desktopFilesPaths + m_iconFilesPaths) {
+        if (QDir::cleanPath(path) == directory) {
+            knownFiles = &m_knownFiles[path];
+            break;
+        }
+    }
+
+    if (!knownFiles) {
+        // Changes in a directory watched by someone else
+        return;
+    }
+
+    foreach (const QString &path, removed) {
+        const QString filename = QFileInfo(path).fileName();
+        if (!filename.startsWith(".") && knownFiles->remove(filename)) {
+            removeFile(path);
         }
     }
 
-    if (!added.isEmpty()) {
-        m_watcher.addPaths(added);
-
-        foreach (const QString &filename, added) {
-            m_modifiedFiles.removeAll(filename);
-            if (m_removedFiles.contains(filename)) {
-                // We have a "removed" notification that's not sent out yet
-                // Just remove this notification, as if nothing happened
-                //
-                // (=> the file has vanished and re-appeared quickly)
-                m_removedFiles.removeAll(filename);
-            } else {
-                m_addedFiles.append(filename);
-            }
+    // A file may be reported as added although it was known already, if another
+    // file was renamed over it. Such files are treated as modified.
+    foreach (const QString &path, added + modified) {
+        const QString filename = QFileInfo(path).fileName();
+        if (filename.startsWith(".")) {
+            continue;
+        }
+
+        if (knownFiles->contains(filename)) {
+            m_modifiedFiles.insert(path);
+        } else {
+            knownFiles->insert(filename);
+            addFile(path);
         }
     }
 
     // Schedule updating the launcher icons
     m_holdbackTimer.start(LAUNCHER_MONITOR_HOLDBACK_TIMEOUT_MS);
+}
 
-    knownFiles = seen;
+void LauncherMonitor::onEventsLost()
+{
+    // Some changes were not reported, so find out the current state of the directories
+    foreach (const QString &path, m_desktopFilesPaths + m_iconFilesPaths)
+        onDirectoryChanged(path);
 }
 
-void LauncherMonitor::onFileChanged(const QString &path)
+void LauncherMonitor::addFile(const QString &path)
 {
-    m_modifiedFiles.append(path);
-    // Schedule updating the launcher icons
-    m_holdbackTimer.start(LAUNCHER_MONITOR_HOLDBACK_TIMEOUT_MS);
+    m_modifiedFiles.remove(path);
+    if (m_removedFiles.remove(path)) {
+        // We have a "removed" notification that's not sent out yet
+        // Replace it with a modification, as the file may have different
+        // contents now
+        //
+        // (=> the file has vanished and re-appeared quickly)
+        m_modifiedFiles.insert(path);
+    } else {
+        m_addedFiles.insert(path);
+    }
+}
+
+void LauncherMonitor::removeFile(const QString &path)
+{
+    m_modifiedFiles.remove(path);
+    if (m_addedFiles.remove(path)) {
+        // We had an "added" notification that's not sent out yet
+        // Just remove this notification, as if nothing happened
+        //
+        // (=> the file has been added and quickly removed again)
+    } else {
+        m_removedFiles.insert(path);
+    }
 }
 
 void LauncherMonitor::onHoldbackTimerTimeout()
 {
-    QStringList modifiedCandidates = m_modifiedFiles;
+    const QStringList modifiedCandidates = m_modifiedFiles.toList();
     foreach (const QString &filename, modifiedCandidates) {
         // This takes care of avoiding sending modifications for two cases:
         //   1. The file was added and then modified
         //   2. The file was modified and then removed
         if (m_addedFiles.contains(filename) || m_removedFiles.contains(filename)) {
-            m_modifiedFiles.removeOne(filename);
+            m_modifiedFiles.remove(filename);
         }
     }
 
@@ -228,14 +275,37 @@ void LauncherMonitor::onHoldbackTimerTimeout()
         return;
     }
 
+    const QStringList added = m_addedFiles.toList();
+    const QStringList modified = m_modifiedFiles.toList();
+    const QStringList removed = m_removedFiles.toList();
+
     LAUNCHER_DEBUG("=========");
-    LAUNCHER_DEBUG("Added:" << m_addedFiles);
-    LAUNCHER_DEBUG("Modified:" << m_modifiedFiles);
-    LAUNCHER_DEBUG("Removed:" << m_removedFiles);
+    LAUNCHER_DEBUG("Added:" << added);
+    LAUNCHER_DEBUG("Modified:" << modified);
+    LAUNCHER_DEBUG("Removed:" << removed);
     LAUNCHER_DEBUG("=========");
 
-    emit filesUpdated(m_addedFiles, m_modifiedFiles, m_removedFiles);
     m_addedFiles.clear();
     m_modifiedFiles.clear();
     m_removedFiles.clear();
+
+    emit filesUpdated(added, modified, removed);
+}
+
+void LauncherMonitor::FileSet::insert(const QString &path)
+{
+    if (!m_indexes.contains(path)) {
+        m_indexes.insert(path, m_nextIndex++);
+    }
+}
+
+QStringList LauncherMonitor::FileSet::toList() const
+{
+    // Order the paths by their insertion index
+    QMap<quint64, QString> ordered;
+    QHash<QString, quint64>::const_iterator it = m_indexes.constBegin(), end = m_indexes.constEnd();
+    for ( ; it != end; ++it) {
+        ordered.insert(it.value(), it.key());
+    }
+    return ordered.values();
 }
@@ -20,11 +20,12 @@
 
 #include <QObject>
 
+#include <QHash>
 #include <QMap>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 
-#include <QFileSystemWatcher>
 #include <QTimer>
 
 class LauncherMonitor : public QObject
@@ -50,23 +51,45 @@ signals:
 private:
     void initialize();
     void setDirectories(const QStringList &newDirs, QStringList &targetDirs);
+    void addFile(const QString &path);
+    void removeFile(const QString &path);
+
+    // Set of file paths that remembers the order in which the paths were inserted
+    class FileSet
+    {
+    public:
+        FileSet() : m_nextIndex(0) {}
+
+        bool contains(const QString &path) const { return m_indexes.contains(path); }
+        void insert(const QString &path);
+        bool remove(const QString &path) { return m_indexes.remove(path) > 0; }
+        bool isEmpty() const { return m_indexes.isEmpty(); }
+        void clear() { m_indexes.clear(); m_nextIndex = 0; }
+        QStringList toList() const;
+
+    private:
+        QHash<QString, quint64> m_indexes;
+        quint64 m_nextIndex;
+    };
 
     // fields
-    QFileSystemWatcher m_watcher;
     QTimer m_holdbackTimer;
 
-    QMap<QString, QStringList> m_knownFiles;
+    QMap<QString, QSet<QString> > m_knownFiles;
 
-    QStringList m_addedFiles;
-    QStringList m_modifiedFiles;
-    QStringList m_removedFiles;
+    FileSet m_addedFiles;
+    FileSet m_modifiedFiles;
+    FileSet m_removedFiles;
 
     QStringList m_desktopFilesPaths;
     QStringList m_iconFilesPaths;
 
+    friend class Ut_LauncherMonitor;
+
 private slots:
     void onDirectoryChanged(const QString &path);
-    void onFileChanged(const QString &path);
+    void onFilesChanged(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
+    void onEventsLost();
     void onHoldbackTimerTimeout();
 };
 
@@ -0,0 +1,217 @@
+// This file is part of lipstick, a QML desktop library
+//
+// Copyright (c) 2015 Jolla Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License version 2.1 as published by the Free Software Foundation
+// and appearing in the file LICENSE.LGPL included in the packaging
+// of this file.
+//
+// This code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+
+#include "launcherpositionstore.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+
+// Identifies the launcher position files ("LPOS")
+static const quint32 POSITIONS_MAGIC = 0x4c504f53;
+
+// The version of the launcher position file format
+static const quint32 POSITIONS_VERSION = 1;
+
+static bool readOrder(const QString &path, QStringList *order)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QStringList paths;
+    stream >> magic >> version;
+    if (magic != POSITIONS_MAGIC || version != POSITIONS_VERSION) {
+        qWarning() << "Ignoring launcher positions in unknown format:" << path;
+        return false;
+    }
+
+    stream >> paths;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Ignoring corrupted launcher positions:" << path;
+        return false;
+    }
+
+    *order = paths;
+    return true;
+}
+
+static bool writeOrder(const QString &path, const QStringList &order)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write launcher positions:" << path << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << POSITIONS_MAGIC << POSITIONS_VERSION << order;
+    return file.commit();
+}
+
+class LauncherPositionStore::Writer : public QRunnable
+{
+public:
+    explicit Writer(LauncherPositionStore *store) : m_store(store) {}
+
+    void run()
+    {
+        QStringList order;
+        {
+            QMutexLocker locker(&m_store->m_mutex);
+            order = m_store->m_pendingOrder;
+            m_store->m_writePending = false;
+        }
+
+        const bool written = writeOrder(m_store->m_path, order);
+
+        QMutexLocker locker(&m_store->m_mutex);
+        m_store->m_writeFailed = !written;
+    }
+
+private:
+    LauncherPositionStore *m_store;
+};
+
+LauncherPositionStore::LauncherPositionStore(const QString &path)
+    : m_path(path)
+    , m_hasPositions(false)
+    , m_writePending(false)
+    , m_writeFailed(false)
+{
+    // A single writer thread keeps the writes in order
+    m_writerPool.setMaxThreadCount(1);
+
+    QStringList order;
+    if (readOrder(m_path, &order)) {
+        setOrder(order);
+        m_hasPositions = true;
+    }
+}
+
+LauncherPositionStore::~LauncherPositionStore()
+{
+    waitForWrites();
+}
+
+QString LauncherPositionStore::path() const
+{
+    return m_path;
+}
+
+bool LauncherPositionStore::hasPositions() const
+{
+    return m_hasPositions;
+}
+
+int LauncherPositionStore::position(const QString &filePath) const
+{
+    return m_positions.value(filePath, -1);
+}
+
+bool LauncherPositionStore::reload()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_writePending || m_writerPool.activeThreadCount() > 0) {
+            return false;
+        }
+    }
+
+    QStringList order;
+    if (!readOrder(m_path, &order) || order == m_order) {
+        return false;
+    }
+
+    setOrder(order);
+    m_hasPositions = true;
+    return true;
+}
+
+bool LauncherPositionStore::save(const QStringList &order)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_writeFailed) {
+            // The current order is not in the file, so it is not skipped as unchanged
+            m_writeFailed = false;
+            m_order.clear();
+        }
+    }
+
+    if (m_hasPositions && order == m_order) {
+        return false;
+    }
+
+    setOrder(order);
+    m_hasPositions = true;
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingOrder = order;
+    if (!m_writePending) {
+        // A writer which has not taken the pending order yet writes this one too
+        m_writePending = true;
+        m_writerPool.start(new Writer(this));
+    }
+    return true;
+}
+
+bool LauncherPositionStore::write(const QStringList &order)
+{
+    waitForWrites();
+
+    if (!writeOrder(m_path, order)) {
+        return false;
+    }
+
+    setOrder(order);
+    m_hasPositions = true;
+
+    QMutexLocker locker(&m_mutex);
+    m_writeFailed = false;
+    return true;
+}
+
+void LauncherPositionStore::waitForWrites()
+{
+    m_writerPool.waitForDone();
+}
+
+void LauncherPositionStore::setOrder(const QStringList &order)
+{
+    m_order = order;
+    m_positions.clear();
+    m_positions.reserve(order.count());
+    for (int i = 0; i < order.count(); ++i) {
+        // The first position of a duplicated path is used
+        if (!m_positions.contains(order.at(i))) {
+            m_positions.insert(order.at(i), i);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+// This file is part of lipstick, a QML desktop library
+//
+// Copyright (c) 2015 Jolla Ltd.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License version 2.1 as published by the Free Software Foundation
+// and appearing in the file LICENSE.LGPL included in the packaging
+// of this file.
+//
+// This code is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+
+#ifndef LAUNCHERPOSITIONSTORE_H
+#define LAUNCHERPOSITIONSTORE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+/*!
+ * Stores the order of launcher items in a single file.
+ *
+ * The order is kept in memory and written only when it changes. Writes are
+ * done in a thread of their own, and the file is replaced atomically, so a
+ * partially written order is never read. Orders saved while a write is in
+ * progress are coalesced, so only the latest one is written. If a write
+ * fails, the next save writes the order again.
+ */
+class LauncherPositionStore
+{
+public:
+    explicit LauncherPositionStore(const QString &path);
+
+    //! Waits for any pending writes to finish.
+    ~LauncherPositionStore();
+
+    //! Returns the path of the file the order is stored in.
+    QString path() const;
+
+    //! Returns whether an order has been stored, either in the file or by calling save().
+    bool hasPositions() const;
+
+    //! Returns the position of the given file path in the order, or -1 if it has no position.
+    int position(const QString &filePath) const;
+
+    /*!
+     * Reads the order from the file again. Changes are not read while
+     * writes are pending, as the file would not contain the latest order.
+     *
+     * \return \c true if the order changed, \c false otherwise
+     */
+    bool reload();
+
+    /*!
+     * Stores an order of file paths, unless it is the same as the current order.
+     *
+     * \return \c true if the order changed and will be written, \c false otherwise
+     */
+    bool save(const QStringList &order);
+
+    /*!
+     * Writes an order of file paths synchronously, after the pending writes.
+     * The order is kept only if the write succeeds.
+     *
+     * \return \c true if the order was written, \c false otherwise
+     */
+    bool write(const QStringList &order);
+
+    //! Waits until the pending writes have finished.
+    void waitForWrites();
+
+private:
+    Q_DISABLE_COPY(LauncherPositionStore)
+
+    class Writer;
+
+    void setOrder(const QStringList &order);
+
+    QString m_path;
+    QStringList m_order;
+    QHash<QString, int> m_positions;
+    bool m_hasPositions;
+
+    // Protects the pending order, which is taken by the writer thread
+    QMutex m_mutex;
+    QStringList m_pendingOrder;
+    bool m_writePending;
+    bool m_writeFailed;
+    QThreadPool m_writerPool;
+};
+
+#endif // LAUNCHERPOSITIONSTORE_H
@@ -14,33 +14,72 @@
 //
 // Copyright (c) 2014, Sami Kananoja <sami.kananoja@jolla.com>
 
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 
 #include "launcherwatchermodel.h"
 #include "launcheritem.h"
+#include "directorywatcher.h"
+
+static QString watchedDirectory(const QString &path)
+{
+    return QFileInfo(path).absolutePath();
+}
 
 LauncherWatcherModel::LauncherWatcherModel(QObject *parent) :
-    QObjectListModel(parent),
-    _fileSystemWatcher()
+    QObjectListModel(parent)
 {
-    connect(&_fileSystemWatcher, SIGNAL(fileChanged(QString)), this, SLOT(monitoredFileChanged(QString)));
+    connect(DirectoryWatcher::instance(), SIGNAL(filesChanged(QString,QStringList,QStringList,QStringList)),
+            this, SLOT(monitoredFilesChanged(QString,QStringList,QStringList,QStringList)));
+    connect(DirectoryWatcher::instance(), SIGNAL(eventsLost()), this, SLOT(onEventsLost()));
 }
 
 LauncherWatcherModel::~LauncherWatcherModel()
 {
+    foreach (LauncherItem *item, *getList<LauncherItem>()) {
+        DirectoryWatcher::instance()->removeDirectory(watchedDirectory(item->filePath()));
+    }
 }
 
-void LauncherWatcherModel::monitoredFileChanged(const QString &changedPath)
+void LauncherWatcherModel::monitoredFilesChanged(const QString &, const QStringList &,
+        const QStringList &, const QStringList &removed)
 {
-    if (!QFile(changedPath).exists()) {
-        foreach (LauncherItem *item, *getList<LauncherItem>()) {
-            if (item->filePath() == changedPath) {
-                removeItem(item);
-                emit filePathsChanged();
-                break;
-            }
+    if (removed.isEmpty()) {
+        return;
+    }
+
+    bool changed = false;
+    QList<LauncherItem *> items = *getList<LauncherItem>();
+    foreach (LauncherItem *item, items) {
+        if (removed.contains(QDir::cleanPath(QFileInfo(item->filePath()).absoluteFilePath()))) {
+            DirectoryWatcher::instance()->removeDirectory(watchedDirectory(item->filePath()));
+            removeItem(item);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        emit filePathsChanged();
+    }
+}
+
+void LauncherWatcherModel::onEventsLost()
+{
+    // The removals may have been lost with the other events, so check each file
+    bool changed = false;
+    QList<LauncherItem *> items = *getList<LauncherItem>();
+    foreach (LauncherItem *item, items) {
+        if (!QFile::exists(item->filePath())) {
+            DirectoryWatcher::instance()->removeDirectory(watchedDirectory(item->filePath()));
+            removeItem(item);
+            changed = true;
         }
     }
+
+    if (changed) {
+        emit filePathsChanged();
+    }
 }
 
 QStringList LauncherWatcherModel::filePaths()
@@ -83,7 +122,7 @@ void LauncherWatcherModel::setFilePaths(QStringList paths)
             LauncherItem *item = new LauncherItem(path, this);
             if (item->isValid()) {
                 insertItem(insertIndex, item);
-                _fileSystemWatcher.addPath(path);
+                DirectoryWatcher::instance()->addDirectory(watchedDirectory(path));
             } else {
                 delete item;
                 continue;
@@ -94,7 +133,7 @@ void LauncherWatcherModel::setFilePaths(QStringList paths)
 
     while (insertIndex < itemCount()) {
         LauncherItem *item = static_cast<LauncherItem *>(get(insertIndex));
-        _fileSystemWatcher.removePath(item->filePath());
+        DirectoryWatcher::instance()->removeDirectory(watchedDirectory(item->filePath()));
         removeItem(insertIndex);
         delete item;
     }
@@ -19,7 +19,6 @@
 
 #include <QObject>
 #include <QStringList>
-#include <QFileSystemWatcher>
 
 #include "qobjectlistmodel.h"
 #include "lipstickglobal.h"
@@ -31,10 +30,9 @@ class LIPSTICK_EXPORT LauncherWatcherModel : public QObjectListModel
 
     Q_PROPERTY(QStringList filePaths READ filePaths WRITE setFilePaths NOTIFY filePathsChanged)
 
-    QFileSystemWatcher _fileSystemWatcher;
-
 private slots:
-    void monitoredFileChanged(const QString &changedPath);
+    void monitoredFilesChanged(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
+    void onEventsLost();
 
 public:
     explicit LauncherWatcherModel(QObject *parent = 0);
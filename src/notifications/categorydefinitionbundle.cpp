@@ -0,0 +1,279 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "categorydefinitionbundle.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMap>
+#include <QSaveFile>
+#include <QSettings>
+#include <QVector>
+#include <string.h>
+
+//! The maximum size of the category definition file
+static const uint FILE_MAX_SIZE = 32768;
+
+//! Identifies the category definition bundle files
+static const char BUNDLE_MAGIC[8] = { 'L', 'I', 'P', 'S', 'C', 'A', 'T', 'B' };
+
+//! The version of the category definition bundle format
+static const quint32 BUNDLE_VERSION = 2;
+
+struct CategoryDefinitionBundle::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 categoryCount;
+    quint32 parameterCount;
+};
+
+struct CategoryDefinitionBundle::Entry
+{
+    quint32 nameOffset;
+    quint32 nameLength;
+    quint32 firstParameter;
+    quint32 parameterCount;
+    quint32 fileModified;
+    quint32 fileSize;
+};
+
+struct CategoryDefinitionBundle::Parameter
+{
+    quint32 keyOffset;
+    quint32 keyLength;
+    quint32 valueOffset;
+    quint32 valueLength;
+};
+
+namespace {
+
+//! Returns the modification time of a file as stored in a bundle, in seconds since the epoch
+quint32 modificationTime(const QFileInfo &file)
+{
+    return file.lastModified().toTime_t();
+}
+
+//! Appends a string to the string data of a bundle and returns its offset in the bundle
+quint32 appendString(QByteArray &strings, quint32 stringsOffset, const QString &string)
+{
+    const quint32 offset = stringsOffset + strings.size();
+    strings.append(reinterpret_cast<const char *>(string.constData()), string.size() * sizeof(QChar));
+    return offset;
+}
+
+}
+
+CategoryDefinitionBundle::CategoryDefinitionBundle(const QString &path) :
+    file(path),
+    data(0),
+    size(0)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    size = file.size();
+    if (size < qint64(sizeof(Header))) {
+        file.close();
+        return;
+    }
+
+    const uchar *mapped = file.map(0, size);
+    if (!mapped) {
+        file.close();
+        return;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(mapped);
+    const quint64 tablesSize = sizeof(Header) + quint64(header->categoryCount) * sizeof(Entry) + quint64(header->parameterCount) * sizeof(Parameter);
+    if (memcmp(header->magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 || header->version != BUNDLE_VERSION || tablesSize > quint64(size)) {
+        file.unmap(const_cast<uchar *>(mapped));
+        file.close();
+        return;
+    }
+
+    data = mapped;
+}
+
+CategoryDefinitionBundle::~CategoryDefinitionBundle()
+{
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+    }
+}
+
+bool CategoryDefinitionBundle::isValid() const
+{
+    return data != 0;
+}
+
+bool CategoryDefinitionBundle::contains(const QString &category) const
+{
+    return entry(category) != 0;
+}
+
+QHash<QString, QString> CategoryDefinitionBundle::categoryParameters(const QString &category) const
+{
+    QHash<QString, QString> parameters;
+
+    const Entry *categoryEntry = entry(category);
+    if (categoryEntry) {
+        const Header *header = reinterpret_cast<const Header *>(data);
+        if (quint64(categoryEntry->firstParameter) + categoryEntry->parameterCount <= header->parameterCount) {
+            const Parameter *parameter = reinterpret_cast<const Parameter *>(data + sizeof(Header) + header->categoryCount * sizeof(Entry)) + categoryEntry->firstParameter;
+            parameters.reserve(categoryEntry->parameterCount);
+            for (quint32 i = 0; i < categoryEntry->parameterCount; ++i, ++parameter) {
+                parameters.insert(string(parameter->keyOffset, parameter->keyLength), string(parameter->valueOffset, parameter->valueLength));
+            }
+        }
+    }
+
+    return parameters;
+}
+
+bool CategoryDefinitionBundle::isUpToDate(const QString &category, const QFileInfo &file) const
+{
+    const Entry *categoryEntry = entry(category);
+    return categoryEntry && file.exists() && categoryEntry->fileModified == modificationTime(file) && categoryEntry->fileSize == quint64(file.size());
+}
+
+const CategoryDefinitionBundle::Entry *CategoryDefinitionBundle::entry(const QString &category) const
+{
+    if (!data) {
+        return 0;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+    const Entry *entries = reinterpret_cast<const Entry *>(data + sizeof(Header));
+
+    // The entries are sorted by category name
+    int first = 0;
+    int last = int(header->categoryCount) - 1;
+    while (first <= last) {
+        const int middle = first + (last - first) / 2;
+        const Entry &candidate(entries[middle]);
+        if (candidate.nameOffset % sizeof(QChar) != 0 || quint64(candidate.nameOffset) + quint64(candidate.nameLength) * sizeof(QChar) > quint64(size)) {
+            return 0;
+        }
+
+        const QString name(QString::fromRawData(reinterpret_cast<const QChar *>(data + candidate.nameOffset), candidate.nameLength));
+        const int comparison = name.compare(category);
+        if (comparison < 0) {
+            first = middle + 1;
+        } else if (comparison > 0) {
+            last = middle - 1;
+        } else {
+            return &candidate;
+        }
+    }
+
+    return 0;
+}
+
+QString CategoryDefinitionBundle::string(quint32 offset, quint32 length) const
+{
+    if (offset % sizeof(QChar) != 0 || quint64(offset) + quint64(length) * sizeof(QChar) > quint64(size)) {
+        return QString();
+    }
+
+    return QString(reinterpret_cast<const QChar *>(data + offset), length);
+}
+
+bool CategoryDefinitionBundle::readCategoryDefinition(const QString &filePath, QHash<QString, QString> &parameters)
+{
+    QFileInfo file(filePath);
+    if (file.exists() && file.size() != 0 && file.size() <= FILE_MAX_SIZE) {
+        QSettings categoryDefinitionSettings(file.filePath(), QSettings::IniFormat);
+        if (categoryDefinitionSettings.status() == QSettings::NoError) {
+            parameters.clear();
+            foreach (const QString &key, categoryDefinitionSettings.allKeys()) {
+                const QVariant &value(categoryDefinitionSettings.value(key));
+                if (value.canConvert<QStringList>()) {
+                    parameters.insert(key, value.toStringList().join(QStringLiteral(",")));
+                } else {
+                    parameters.insert(key, value.toString());
+                }
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CategoryDefinitionBundle::compile(const QStringList &categoryDefinitionFiles, const QString &path)
+{
+    // The categories are written in sorted order so that they can be looked up with a binary search
+    QMap<QString, QHash<QString, QString> > definitions;
+    QHash<QString, QFileInfo> files;
+    foreach (const QString &filePath, categoryDefinitionFiles) {
+        QHash<QString, QString> parameters;
+        if (readCategoryDefinition(filePath, parameters)) {
+            const QFileInfo file(filePath);
+            definitions.insert(file.completeBaseName(), parameters);
+            files.insert(file.completeBaseName(), file);
+        }
+    }
+
+    int parameterCount = 0;
+    foreach (const QHash<QString, QString> &parameters, definitions) {
+        parameterCount += parameters.count();
+    }
+
+    Header header;
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+    header.version = BUNDLE_VERSION;
+    header.categoryCount = definitions.count();
+    header.parameterCount = parameterCount;
+
+    const quint32 stringsOffset = sizeof(Header) + definitions.count() * sizeof(Entry) + parameterCount * sizeof(Parameter);
+    QVector<Entry> entries;
+    QVector<Parameter> parameters;
+    QByteArray strings;
+    entries.reserve(definitions.count());
+    parameters.reserve(parameterCount);
+
+    QMap<QString, QHash<QString, QString> >::const_iterator it = definitions.constBegin(), end = definitions.constEnd();
+    for ( ; it != end; ++it) {
+        Entry entry;
+        entry.nameOffset = appendString(strings, stringsOffset, it.key());
+        entry.nameLength = it.key().size();
+        entry.firstParameter = parameters.count();
+        entry.parameterCount = it.value().count();
+        entry.fileModified = modificationTime(files.value(it.key()));
+        entry.fileSize = files.value(it.key()).size();
+        entries.append(entry);
+
+        QHash<QString, QString>::const_iterator pit = it.value().constBegin(), pend = it.value().constEnd();
+        for ( ; pit != pend; ++pit) {
+            Parameter parameter;
+            parameter.keyOffset = appendString(strings, stringsOffset, pit.key());
+            parameter.keyLength = pit.key().size();
+            parameter.valueOffset = appendString(strings, stringsOffset, pit.value());
+            parameter.valueLength = pit.value().size();
+            parameters.append(parameter);
+        }
+    }
+
+    // Replace any existing bundle atomically, so that readers never see a partially written bundle
+    QSaveFile bundleFile(path);
+    if (!bundleFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    bundleFile.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    bundleFile.write(reinterpret_cast<const char *>(entries.constData()), entries.count() * sizeof(Entry));
+    bundleFile.write(reinterpret_cast<const char *>(parameters.constData()), parameters.count() * sizeof(Parameter));
+    bundleFile.write(strings);
+    return bundleFile.commit();
+}
@@ -0,0 +1,129 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef CATEGORYDEFINITIONBUNDLE_H
+#define CATEGORYDEFINITIONBUNDLE_H
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class QFileInfo;
+
+/*!
+ * \class CategoryDefinitionBundle
+ *
+ * \brief Provides access to a precompiled bundle of category definitions.
+ *
+ * A bundle contains the parameters of a set of category definition files in
+ * a single binary file, which is memory mapped when opened. The categories
+ * are stored in sorted order, so looking up a category does not require the
+ * bundle to be parsed.
+ *
+ * Bundles are written with compile(). The bundle is only valid on the kind of
+ * system it was compiled on, as the values are stored in native byte order.
+ *
+ * The modification time and size of each category definition file are
+ * stored with its parameters, so that a file changed after the bundle was
+ * compiled can be told apart even if it is older than the bundle, as files
+ * installed from packages keep the modification times they were built with.
+ */
+class CategoryDefinitionBundle
+{
+public:
+    /*!
+     * Opens a category definition bundle. If the bundle does not exist or
+     * can not be read, the bundle is not valid.
+     *
+     * \param path the path of the bundle file
+     */
+    explicit CategoryDefinitionBundle(const QString &path);
+
+    //! Closes the category definition bundle.
+    ~CategoryDefinitionBundle();
+
+    //! Returns whether the bundle was opened successfully.
+    bool isValid() const;
+
+    /*!
+     * Checks whether the bundle contains the definition of the given category.
+     *
+     * \param category the category
+     * \return \c true if the bundle contains the category, \c false otherwise
+     */
+    bool contains(const QString &category) const;
+
+    /*!
+     * Returns the parameters of the given category in the bundle. If the
+     * bundle does not contain the category, an empty hash is returned.
+     *
+     * \param category the category
+     */
+    QHash<QString, QString> categoryParameters(const QString &category) const;
+
+    /*!
+     * Checks whether the bundled definition of the given category was
+     * compiled from the category definition file as it is now.
+     *
+     * \param category the category
+     * \param file the category definition file of the category
+     * \return \c true if the file has the modification time and size it had when the bundle was compiled, \c false otherwise
+     */
+    bool isUpToDate(const QString &category, const QFileInfo &file) const;
+
+    /*!
+     * Reads the parameters of a category definition file. Files which are
+     * empty or too large are not read.
+     *
+     * \param filePath the path of the category definition file
+     * \param parameters the hash to store the parameters in
+     * \return \c true if the file was read successfully, \c false otherwise
+     */
+    static bool readCategoryDefinition(const QString &filePath, QHash<QString, QString> &parameters);
+
+    /*!
+     * Compiles category definition files into a bundle. The category of each
+     * file is its base name. Files which can not be read are left out.
+     *
+     * \param categoryDefinitionFiles the paths of the category definition files
+     * \param path the path of the bundle file to write
+     * \return \c true if the bundle was written successfully, \c false otherwise
+     */
+    static bool compile(const QStringList &categoryDefinitionFiles, const QString &path);
+
+private:
+    Q_DISABLE_COPY(CategoryDefinitionBundle)
+
+    struct Header;
+    struct Entry;
+    struct Parameter;
+
+    //! Returns the entry of the given category, or 0 if the bundle does not contain the category
+    const Entry *entry(const QString &category) const;
+
+    //! Returns the string at the given offset of the bundle
+    QString string(quint32 offset, quint32 length) const;
+
+    //! The bundle file
+    QFile file;
+
+    //! The memory mapped contents of the bundle file, or 0 if the bundle is not valid
+    const uchar *data;
+
+    //! The size of the bundle file
+    qint64 size;
+};
+
+#endif // CATEGORYDEFINITIONBUNDLE_H
@@ -15,31 +15,44 @@
 ****************************************************************************/
 
 #include "categorydefinitionstore.h"
+#include "categorydefinitionbundle.h"
+#include "directorywatcher.h"
 #include <QFileInfo>
 #include <QDir>
 
 //! The file extension for the category definition files
 static const char *FILE_EXTENSION = ".conf";
 
-//! The maximum size of the category definition file
-static const uint FILE_MAX_SIZE = 32768;
+//! The file extension for the category definition bundle
+static const char *BUNDLE_FILE_EXTENSION = ".bundle";
 
 CategoryDefinitionStore::CategoryDefinitionStore(const QString &categoryDefinitionsPath, uint maxStoredCategoryDefinitions, QObject *parent) :
     QObject(parent),
     categoryDefinitionsPath(categoryDefinitionsPath),
-    maxStoredCategoryDefinitions(maxStoredCategoryDefinitions)
+    maxStoredCategoryDefinitions(maxStoredCategoryDefinitions),
+    bundle(new CategoryDefinitionBundle(QDir::cleanPath(categoryDefinitionsPath) + BUNDLE_FILE_EXTENSION)),
+    mostRecentlyUsed(0),
+    leastRecentlyUsed(0)
 {
     if (!this->categoryDefinitionsPath.endsWith('/')) {
         this->categoryDefinitionsPath.append('/');
     }
 
     // Watch for changes in category definition files
-    categoryDefinitionPathWatcher.addPath(this->categoryDefinitionsPath);
-    connect(&categoryDefinitionPathWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(updateCategoryDefinitionFileList()));
-    connect(&categoryDefinitionPathWatcher, SIGNAL(fileChanged(QString)), this, SLOT(updateCategoryDefinitionFile(QString)));
+    DirectoryWatcher *watcher = DirectoryWatcher::instance();
+    watcher->addDirectory(this->categoryDefinitionsPath);
+    connect(watcher, SIGNAL(filesChanged(QString,QStringList,QStringList,QStringList)), this, SLOT(updateCategoryDefinitionFiles(QString,QStringList,QStringList,QStringList)));
+    connect(watcher, SIGNAL(eventsLost()), this, SLOT(updateCategoryDefinitionFileList()));
     updateCategoryDefinitionFileList();
 }
 
+CategoryDefinitionStore::~CategoryDefinitionStore()
+{
+    DirectoryWatcher::instance()->removeDirectory(categoryDefinitionsPath);
+    qDeleteAll(categoryDefinitions);
+    delete bundle;
+}
+
 void CategoryDefinitionStore::updateCategoryDefinitionFileList()
 {
     QDir categoryDefinitionsDir(categoryDefinitionsPath);
@@ -49,27 +62,64 @@ void CategoryDefinitionStore::updateCategoryDefinitionFileList()
 
         QSet<QString> files = categoryDefinitionsDir.entryList(filter, QDir::Files).toSet();
         QSet<QString> removedFiles = categoryDefinitionFiles - files;
+        const bool initialListing = categoryDefinitionFiles.isEmpty();
 
         foreach(const QString &removedCategory, removedFiles) {
             QString category = QFileInfo(removedCategory).completeBaseName();
-            QString categoryDefinitionPath = categoryDefinitionsPath + removedCategory;
-            categoryDefinitionPathWatcher.removePath(categoryDefinitionPath);
-            categoryDefinitions.remove(category);
+            removeCategoryDefinition(category);
             emit categoryDefinitionUninstalled(category);
         }
 
         categoryDefinitionFiles = files;
 
-        // Add category definition files to watcher
-        foreach(QString file, categoryDefinitionFiles){
-            QString categoryDefinitionFilePath = categoryDefinitionsPath + file;
-            if (!categoryDefinitionPathWatcher.files().contains(categoryDefinitionFilePath)) {
-                categoryDefinitionPathWatcher.addPath(categoryDefinitionFilePath);
+        if (!initialListing) {
+            // Changes to the files in the bundle may have gone unnoticed, so check them
+            foreach(const QString &file, categoryDefinitionFiles) {
+                QString categoryDefinitionFilePath = categoryDefinitionsPath + file;
+                QString category = QFileInfo(file).completeBaseName();
+                if (isBundled(category) && isChangedSinceBundle(category, QFileInfo(categoryDefinitionFilePath))) {
+                    unbundledCategories.insert(category);
+                    updateCategoryDefinitionFile(categoryDefinitionFilePath);
+                }
             }
         }
     }
 }
 
+void CategoryDefinitionStore::updateCategoryDefinitionFiles(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed)
+{
+    if (directory != QDir::cleanPath(categoryDefinitionsPath)) {
+        return;
+    }
+
+    foreach(const QString &path, removed) {
+        QFileInfo fileInfo(path);
+        if (path.endsWith(FILE_EXTENSION) && categoryDefinitionFiles.remove(fileInfo.fileName())) {
+            QString category = fileInfo.completeBaseName();
+            removeCategoryDefinition(category);
+            emit categoryDefinitionUninstalled(category);
+        }
+    }
+
+    // A file renamed over an existing one is reported as added, so it is handled as a modification
+    foreach(const QString &path, added + modified) {
+        QFileInfo fileInfo(path);
+        if (!path.endsWith(FILE_EXTENSION)) {
+            continue;
+        }
+
+        // The bundle no longer has the current definition, even if the file keeps its old modification time
+        QString category = fileInfo.completeBaseName();
+        unbundledCategories.insert(category);
+
+        const bool known = categoryDefinitionFiles.contains(fileInfo.fileName());
+        categoryDefinitionFiles.insert(fileInfo.fileName());
+        if (known) {
+            updateCategoryDefinitionFile(path);
+        }
+    }
+}
+
 void CategoryDefinitionStore::updateCategoryDefinitionFile(const QString &path)
 {
     QFileInfo fileInfo(path);
@@ -82,25 +132,13 @@ void CategoryDefinitionStore::updateCategoryDefinitionFile(const QString &path)
 
 bool CategoryDefinitionStore::categoryDefinitionExists(const QString &category) const
 {
-    bool categoryFound = false;
-
-    if (!categoryDefinitions.contains(category)) {
-        // If the category definition has not been loaded yet load it
-        loadSettings(category);
-    }
-
-    if (categoryDefinitions.contains(category)) {
-        categoryDefinitionAccessed(category);
-        categoryFound = true;
-    }
-
-    return categoryFound;
+    return categoryDefinition(category) != 0;
 }
 
 QList<QString> CategoryDefinitionStore::allKeys(const QString &category) const
 {
-    if (categoryDefinitionExists(category)) {
-        return categoryDefinitions.value(category)->allKeys();
+    if (const CategoryDefinition *definition = categoryDefinition(category)) {
+        return definition->parameters.keys();
     }
 
     return QList<QString>();
@@ -108,8 +146,8 @@ QList<QString> CategoryDefinitionStore::allKeys(const QString &category) const
 
 bool CategoryDefinitionStore::contains(const QString &category, const QString &key) const
 {
-    if (categoryDefinitionExists(category)) {
-        return categoryDefinitions.value(category)->contains(key);
+    if (const CategoryDefinition *definition = categoryDefinition(category)) {
+        return definition->parameters.contains(key);
     }
 
     return false;
@@ -117,13 +155,8 @@ bool CategoryDefinitionStore::contains(const QString &category, const QString &k
 
 QString CategoryDefinitionStore::value(const QString &category, const QString &key) const
 {
-    if (contains(category, key)) {
-        const QVariant &value(categoryDefinitions.value(category)->value(key));
-        if (value.canConvert<QStringList>()) {
-            return value.toStringList().join(QStringLiteral(","));
-        } else {
-            return value.toString();
-        }
+    if (const CategoryDefinition *definition = categoryDefinition(category)) {
+        return definition->parameters.value(key);
     }
 
     return QString();
@@ -131,42 +164,116 @@ QString CategoryDefinitionStore::value(const QString &category, const QString &k
 
 QHash<QString, QString> CategoryDefinitionStore::categoryParameters(const QString &category) const
 {
-    QHash<QString, QString> rv;
-
-    if (categoryDefinitionExists(category)) {
-        const QSettings &categoryDefinitionSettings(*(categoryDefinitions.value(category)));
-        foreach (const QString &key, categoryDefinitionSettings.allKeys()) {
-            const QVariant &value(categoryDefinitionSettings.value(key));
-            if (value.canConvert<QStringList>()) {
-                rv.insert(key, value.toStringList().join(QStringLiteral(",")));
-            } else {
-                rv.insert(key, value.toString());
-            }
-        }
+    // The parameters are shared with the stored category definition until modified
+    if (const CategoryDefinition *definition = categoryDefinition(category)) {
+        return definition->parameters;
     }
 
-    return rv;
+    return QHash<QString, QString>();
 }
 
 void CategoryDefinitionStore::loadSettings(const QString &category) const
 {
-    QFileInfo file(QString(categoryDefinitionsPath).append(category).append(FILE_EXTENSION));
-    if (file.exists() && file.size() != 0 && file.size() <= FILE_MAX_SIZE) {
-        QSharedPointer<QSettings> categoryDefinitionSettings(new QSettings(file.filePath(), QSettings::IniFormat));
-        if (categoryDefinitionSettings->status() == QSettings::NoError) {
-            categoryDefinitions.insert(category, categoryDefinitionSettings);
+    const QString filePath(QString(categoryDefinitionsPath).append(category).append(FILE_EXTENSION));
+
+    // Parse the values once so that they can be used as such when accessed
+    QHash<QString, QString> parameters;
+    bool loaded = false;
+    if (isBundled(category)) {
+        QFileInfo file(filePath);
+        if (!file.exists()) {
+            return;
+        }
+        if (isChangedSinceBundle(category, file)) {
+            unbundledCategories.insert(category);
+        } else {
+            parameters = bundle->categoryParameters(category);
+            loaded = true;
         }
     }
+    if (!loaded) {
+        loaded = CategoryDefinitionBundle::readCategoryDefinition(filePath, parameters);
+    }
+
+    if (loaded) {
+        CategoryDefinition *&definition(categoryDefinitions[category]);
+        if (!definition) {
+            definition = new CategoryDefinition(category);
+        }
+        definition->parameters = parameters;
+        categoryDefinitionAccessed(definition);
+    }
+}
+
+bool CategoryDefinitionStore::isBundled(const QString &category) const
+{
+    return bundle->isValid() && !unbundledCategories.contains(category) && bundle->contains(category);
+}
+
+bool CategoryDefinitionStore::isChangedSinceBundle(const QString &category, const QFileInfo &file) const
+{
+    // Files installed from packages keep their build time modification time, so comparing it with the bundle's is not enough
+    return !bundle->isUpToDate(category, file);
 }
 
-void CategoryDefinitionStore::categoryDefinitionAccessed(const QString &category) const
+const CategoryDefinitionStore::CategoryDefinition *CategoryDefinitionStore::categoryDefinition(const QString &category) const
+{
+    CategoryDefinition *definition = categoryDefinitions.value(category);
+    if (!definition) {
+        // If the category definition has not been loaded yet load it
+        loadSettings(category);
+        definition = categoryDefinitions.value(category);
+    }
+
+    if (definition) {
+        categoryDefinitionAccessed(definition);
+    }
+
+    return definition;
+}
+
+void CategoryDefinitionStore::categoryDefinitionAccessed(CategoryDefinition *definition) const
 {
     // Mark the category definition as recently used by moving it to the beginning of the usage list
-    categoryDefinitionUsage.removeAll(category);
-    categoryDefinitionUsage.insert(0, category);
+    if (definition != mostRecentlyUsed) {
+        unlinkCategoryDefinition(definition);
+        definition->next = mostRecentlyUsed;
+        if (mostRecentlyUsed) {
+            mostRecentlyUsed->previous = definition;
+        }
+        mostRecentlyUsed = definition;
+        if (!leastRecentlyUsed) {
+            leastRecentlyUsed = definition;
+        }
+    }
 
     // If there are too many category definitions in memory get rid of the extra ones
-    while (categoryDefinitionUsage.count() > (int)maxStoredCategoryDefinitions) {
-        categoryDefinitions.remove(categoryDefinitionUsage.takeLast());
+    while (categoryDefinitions.count() > (int)maxStoredCategoryDefinitions && leastRecentlyUsed != definition) {
+        removeCategoryDefinition(leastRecentlyUsed->category);
+    }
+}
+
+void CategoryDefinitionStore::removeCategoryDefinition(const QString &category) const
+{
+    CategoryDefinition *definition = categoryDefinitions.take(category);
+    if (definition) {
+        unlinkCategoryDefinition(definition);
+        delete definition;
+    }
+}
+
+void CategoryDefinitionStore::unlinkCategoryDefinition(CategoryDefinition *definition) const
+{
+    if (definition->previous) {
+        definition->previous->next = definition->next;
+    } else if (mostRecentlyUsed == definition) {
+        mostRecentlyUsed = definition->next;
+    }
+    if (definition->next) {
+        definition->next->previous = definition->previous;
+    } else if (leastRecentlyUsed == definition) {
+        leastRecentlyUsed = definition->previous;
     }
+    definition->previous = 0;
+    definition->next = 0;
 }
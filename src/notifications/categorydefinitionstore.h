@@ -18,12 +18,13 @@
 #define CATEGORYDEFINITIONSTORE_H_
 
 #include <QString>
-#include <QMap>
+#include <QHash>
 #include <QSet>
-#include <QSettings>
-#include <QSharedPointer>
 #include <QStringList>
-#include <QFileSystemWatcher>
+#include <QObject>
+
+class CategoryDefinitionBundle;
+class QFileInfo;
 
 /*!
  * A class that represents a notification category store. The category
@@ -33,6 +34,13 @@
  * files it will read. The rationale is to constrain memory usage and startup
  * time in case a huge number of category definitions are defined by a misbehaving
  * package.
+ *
+ * If a category definition bundle compiled from the category definition files
+ * exists next to the category definition directory (for example
+ * /usr/share/lipstick/notificationcategories.bundle), the definitions are read
+ * from the bundle. Only the files which are missing from the bundle or have
+ * changed since it was compiled are read, or which have been modified while
+ * the store is in use.
  */
 class CategoryDefinitionStore : public QObject
 {
@@ -47,6 +55,9 @@ public:
      */
     explicit CategoryDefinitionStore(const QString &categoryDefinitionsPath, uint maxStoredCategoryDefinitions = 100, QObject *parent = 0);
 
+    //! Destroys the category definition store.
+    virtual ~CategoryDefinitionStore();
+
     /*!
      * Tests if the \a category definition exists in the system.
      * Loads the category definition if it exists.
@@ -107,10 +118,20 @@ private slots:
      * Updates the category definition represented in the given file
      *
      * Only updates the category definition if the file is modified. Removing an category definition file is handled
-     * by updateCategoryDefinitionFileList() slot
+     * by updateCategoryDefinitionFiles() slot
      */
     void updateCategoryDefinitionFile(const QString &path);
 
+    /*!
+     * Updates the category definitions whose files have been added, modified or removed
+     *
+     * \param directory the directory containing the files
+     * \param added the paths of the added files
+     * \param modified the paths of the modified files
+     * \param removed the paths of the removed files
+     */
+    void updateCategoryDefinitionFiles(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
+
 signals:
     /*!
      * A signal sent whenever an category definition has been modified
@@ -127,26 +148,65 @@ signals:
     void categoryDefinitionUninstalled(const QString &category);
 
 private:
+    //! A parsed category definition, linked to the list of category definitions in order of use
+    struct CategoryDefinition
+    {
+        CategoryDefinition(const QString &category) : category(category), previous(0), next(0) {}
+
+        //! The category
+        QString category;
+
+        //! The parameters of the category definition
+        QHash<QString, QString> parameters;
+
+        //! The category definition used more recently than this one
+        CategoryDefinition *previous;
+
+        //! The category definition used less recently than this one
+        CategoryDefinition *next;
+    };
+
     //! The path where the category definition files are stored
     QString categoryDefinitionsPath;
 
     //! The maximum number of category definitions to keep in memory
     uint maxStoredCategoryDefinitions;
 
-    //! Map for storing category definitions and corresponding QSettings object
-    mutable QMap<QString, QSharedPointer<QSettings> > categoryDefinitions;
+    //! The precompiled category definitions
+    CategoryDefinitionBundle *bundle;
+
+    //! Categories whose definition files have changed since the bundle was compiled
+    mutable QSet<QString> unbundledCategories;
+
+    //! Returns whether the definition of the category should be read from the bundle
+    bool isBundled(const QString &category) const;
+
+    //! Returns whether the category definition file has changed since the bundle was compiled
+    bool isChangedSinceBundle(const QString &category, const QFileInfo &file) const;
 
-    //! List for keeping track of which category definitions have been most recently used
-    mutable QStringList categoryDefinitionUsage;
+    //! Hash for storing the loaded category definitions keyed by category
+    mutable QHash<QString, CategoryDefinition *> categoryDefinitions;
 
-    //! Load the data into our internal map
+    //! The most recently used category definition
+    mutable CategoryDefinition *mostRecentlyUsed;
+
+    //! The least recently used category definition
+    mutable CategoryDefinition *leastRecentlyUsed;
+
+    //! Load the data into our internal hash
     void loadSettings(const QString &category) const;
 
-    //! Marks the category to be used recently
-    void categoryDefinitionAccessed(const QString &category) const;
+    //! Returns the category definition for the given category, loading it if necessary. Returns 0 if the category doesn't exist.
+    const CategoryDefinition *categoryDefinition(const QString &category) const;
+
+    //! Marks the category definition to be used recently
+    void categoryDefinitionAccessed(CategoryDefinition *definition) const;
+
+    //! Removes the category definition of the given category from memory
+    void removeCategoryDefinition(const QString &category) const;
 
-    //! File system watcher to notice changes in installed category definitions
-    QFileSystemWatcher categoryDefinitionPathWatcher;
+    //! Removes the category definition from the list of category definitions in order of use
+    void unlinkCategoryDefinition(CategoryDefinition *definition) const;
 
     //! List of available category definition files
     QSet<QString> categoryDefinitionFiles;
@@ -19,6 +19,68 @@
 #include <QDBusArgument>
 #include <QtDebug>
 
+namespace {
+
+// Identifiers of the well-known hints which are represented by other properties
+enum HintId {
+    IconHint,
+    ImagePathHint,
+    TimestampHint,
+    PreviewIconHint,
+    PreviewSummaryHint,
+    PreviewBodyHint,
+    UrgencyHint,
+    ItemCountHint,
+    PriorityHint,
+    CategoryHint,
+    UserRemovableHint,
+    HiddenHint,
+    OriginHint,
+    OwnerHint,
+    MaxContentLinesHint,
+    RestoredHint
+};
+
+typedef QHash<QString, HintId> HintIdHash;
+
+HintIdHash createHintIds()
+{
+    HintIdHash ids;
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_ICON), IconHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_IMAGE_PATH), ImagePathHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_TIMESTAMP), TimestampHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_PREVIEW_ICON), PreviewIconHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_PREVIEW_SUMMARY), PreviewSummaryHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_PREVIEW_BODY), PreviewBodyHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_URGENCY), UrgencyHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_ITEM_COUNT), ItemCountHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_PRIORITY), PriorityHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_CATEGORY), CategoryHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_USER_REMOVABLE), UserRemovableHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_HIDDEN), HiddenHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_ORIGIN), OriginHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_OWNER), OwnerHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_MAX_CONTENT_LINES), MaxContentLinesHint);
+    ids.insert(QString::fromLatin1(NotificationManager::HINT_RESTORED), RestoredHint);
+    return ids;
+}
+
+// The well-known hint keys, all in lower case
+const HintIdHash &hintIds()
+{
+    static const HintIdHash ids(createHintIds());
+    return ids;
+}
+
+// Also matches the remote action icon hints, which share the prefix
+const QString &remoteActionPrefix()
+{
+    static const QString prefix(QString::fromLatin1(NotificationManager::HINT_REMOTE_ACTION_PREFIX));
+    return prefix;
+}
+
+}
+
 LipstickNotification::LipstickNotification(const QString &appName, uint replacesId, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expireTimeout, QObject *parent) :
     QObject(parent),
     appName_(appName),
@@ -29,8 +91,8 @@ LipstickNotification::LipstickNotification(const QString &appName, uint replaces
     actions_(actions),
     hints_(hints),
     expireTimeout_(expireTimeout),
-    priority_(hints.value(NotificationManager::HINT_PRIORITY).toInt()),
-    timestamp_(hints.value(NotificationManager::HINT_TIMESTAMP).toDateTime().toMSecsSinceEpoch())
+    priority_(0),
+    timestamp_(0)
 {
     updateHintValues();
 }
@@ -55,6 +117,7 @@ LipstickNotification::LipstickNotification(const LipstickNotification &notificat
     hints_(notification.hints_),
     hintValues_(notification.hintValues_),
     expireTimeout_(notification.expireTimeout_),
+    knownHints_(notification.knownHints_),
     priority_(notification.priority_),
     timestamp_(notification.timestamp_)
 {
@@ -133,57 +196,53 @@ QVariantMap LipstickNotification::hintValues() const
 
 void LipstickNotification::setHints(const QVariantHash &hints)
 {
-    QString oldIcon = icon();
-    quint64 oldTimestamp = timestamp_;
-    QString oldPreviewIcon = previewIcon();
-    QString oldPreviewSummary = previewSummary();
-    QString oldPreviewBody = previewBody();
-    int oldUrgency = urgency();
-    int oldItemCount = itemCount();
-    int oldPriority = priority_;
-    QString oldCategory = category();
+    if (hints_ == hints) {
+        return;
+    }
 
     hints_ = hints;
-    updateHintValues();
+    const uint changes = updateHintValues();
 
-    if (oldIcon != icon()) {
+    if (changes & IconChange) {
         emit iconChanged();
     }
 
-    timestamp_ = hints_.value(NotificationManager::HINT_TIMESTAMP).toDateTime().toMSecsSinceEpoch();
-    if (oldTimestamp != timestamp_) {
+    if (changes & TimestampChange) {
         emit timestampChanged();
     }
 
-    if (oldPreviewIcon != previewIcon()) {
+    if (changes & PreviewIconChange) {
         emit previewIconChanged();
     }
 
-    if (oldPreviewSummary != previewSummary()) {
+    if (changes & PreviewSummaryChange) {
         emit previewSummaryChanged();
     }
 
-    if (oldPreviewBody != previewBody()) {
+    if (changes & PreviewBodyChange) {
         emit previewBodyChanged();
     }
 
-    if (oldUrgency != urgency()) {
+    if (changes & UrgencyChange) {
         emit urgencyChanged();
     }
 
-    if (oldItemCount != itemCount()) {
+    if (changes & ItemCountChange) {
         emit itemCountChanged();
     }
 
-    priority_ = hints_.value(NotificationManager::HINT_PRIORITY).toInt();
-    if (oldPriority != priority_) {
+    if (changes & PriorityChange) {
         emit priorityChanged();
     }
 
-    if (oldCategory != category()) {
+    if (changes & CategoryChange) {
         emit categoryChanged();
     }
 
+    if (changes & UserRemovableChange) {
+        emit userRemovableChanged();
+    }
+
     emit hintsChanged();
 }
 
@@ -199,11 +258,7 @@ void LipstickNotification::setExpireTimeout(int expireTimeout)
 
 QString LipstickNotification::icon() const
 {
-    QString rv(hints_.value(NotificationManager::HINT_ICON).toString());
-    if (rv.isEmpty()) {
-        rv = hints_.value(NotificationManager::HINT_IMAGE_PATH).toString();
-    }
-    return rv;
+    return knownHints_.icon;
 }
 
 QDateTime LipstickNotification::timestamp() const
@@ -213,27 +268,27 @@ QDateTime LipstickNotification::timestamp() const
 
 QString LipstickNotification::previewIcon() const
 {
-    return hints_.value(NotificationManager::HINT_PREVIEW_ICON).toString();
+    return knownHints_.previewIcon;
 }
 
 QString LipstickNotification::previewSummary() const
 {
-    return hints_.value(NotificationManager::HINT_PREVIEW_SUMMARY).toString();
+    return knownHints_.previewSummary;
 }
 
 QString LipstickNotification::previewBody() const
 {
-    return hints_.value(NotificationManager::HINT_PREVIEW_BODY).toString();
+    return knownHints_.previewBody;
 }
 
 int LipstickNotification::urgency() const
 {
-    return hints_.value(NotificationManager::HINT_URGENCY).toInt();
+    return knownHints_.urgency;
 }
 
 int LipstickNotification::itemCount() const
 {
-    return hints_.value(NotificationManager::HINT_ITEM_COUNT).toInt();
+    return knownHints_.itemCount;
 }
 
 int LipstickNotification::priority() const
@@ -243,17 +298,17 @@ int LipstickNotification::priority() const
 
 QString LipstickNotification::category() const
 {
-    return hints_.value(NotificationManager::HINT_CATEGORY).toString();
+    return knownHints_.category;
 }
 
 bool LipstickNotification::isUserRemovable() const
 {
-    return hints_.value(NotificationManager::HINT_USER_REMOVABLE, QVariant(true)).toBool();
+    return knownHints_.userRemovable;
 }
 
 bool LipstickNotification::hidden() const
 {
-    return hints_.value(NotificationManager::HINT_HIDDEN, QVariant(false)).toBool();
+    return knownHints_.hidden;
 }
 
 QVariantList LipstickNotification::remoteActions() const
@@ -315,22 +370,22 @@ QVariantList LipstickNotification::remoteActions() const
 
 QString LipstickNotification::origin() const
 {
-    return hints_.value(NotificationManager::HINT_ORIGIN).toString();
+    return knownHints_.origin;
 }
 
 QString LipstickNotification::owner() const
 {
-    return hints_.value(NotificationManager::HINT_OWNER).toString();
+    return knownHints_.owner;
 }
 
 int LipstickNotification::maxContentLines() const
 {
-    return hints_.value(NotificationManager::HINT_MAX_CONTENT_LINES).toInt();
+    return knownHints_.maxContentLines;
 }
 
 bool LipstickNotification::restored() const
 {
-    return hints_.value(NotificationManager::HINT_RESTORED).toBool();
+    return knownHints_.restored;
 }
 
 quint64 LipstickNotification::internalTimestamp() const
@@ -338,34 +393,136 @@ quint64 LipstickNotification::internalTimestamp() const
     return timestamp_;
 }
 
-void LipstickNotification::updateHintValues()
+uint LipstickNotification::updateHintValues()
 {
     hintValues_.clear();
+    KnownHints knownHints;
+    int priority = 0;
+    quint64 timestamp = QDateTime().toMSecsSinceEpoch();
+    QString imagePath;
 
+    const HintIdHash &ids(hintIds());
     QVariantHash::const_iterator it = hints_.constBegin(), end = hints_.constEnd();
     for ( ; it != end; ++it) {
-        // Filter out the hints that are represented by other properties
         const QString &hint(it.key());
-        if (hint.compare(NotificationManager::HINT_ICON, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_IMAGE_PATH, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_TIMESTAMP, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_PREVIEW_ICON, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_PREVIEW_SUMMARY, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_PREVIEW_BODY, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_URGENCY, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_ITEM_COUNT, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_PRIORITY, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_CATEGORY, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_USER_REMOVABLE, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_HIDDEN, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_ORIGIN, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_OWNER, Qt::CaseInsensitive) != 0 &&
-            hint.compare(NotificationManager::HINT_MAX_CONTENT_LINES, Qt::CaseInsensitive) != 0 &&
-            !hint.startsWith(NotificationManager::HINT_REMOTE_ACTION_PREFIX, Qt::CaseInsensitive) &&
-            !hint.startsWith(NotificationManager::HINT_REMOTE_ACTION_ICON_PREFIX, Qt::CaseInsensitive)) {
-            hintValues_.insert(hint, it.value());
+        const QVariant &value(it.value());
+
+        // Only the exact keys provide the property values, but the hints that are
+        // represented by other properties are filtered out regardless of their case
+        HintIdHash::const_iterator idIt = ids.constFind(hint);
+        const bool exactMatch = (idIt != ids.constEnd());
+        if (!exactMatch) {
+            idIt = ids.constFind(hint.toLower());
+        }
+
+        if (idIt == ids.constEnd()) {
+            if (!hint.startsWith(remoteActionPrefix(), Qt::CaseInsensitive)) {
+                hintValues_.insert(hint, value);
+            }
+            continue;
+        }
+
+        if (idIt.value() == RestoredHint) {
+            hintValues_.insert(hint, value);
         }
+
+        if (!exactMatch) {
+            continue;
+        }
+
+        switch (idIt.value()) {
+        case IconHint:
+            knownHints.icon = value.toString();
+            break;
+        case ImagePathHint:
+            imagePath = value.toString();
+            break;
+        case TimestampHint:
+            timestamp = value.toDateTime().toMSecsSinceEpoch();
+            break;
+        case PreviewIconHint:
+            knownHints.previewIcon = value.toString();
+            break;
+        case PreviewSummaryHint:
+            knownHints.previewSummary = value.toString();
+            break;
+        case PreviewBodyHint:
+            knownHints.previewBody = value.toString();
+            break;
+        case UrgencyHint:
+            knownHints.urgency = value.toInt();
+            break;
+        case ItemCountHint:
+            knownHints.itemCount = value.toInt();
+            break;
+        case PriorityHint:
+            priority = value.toInt();
+            break;
+        case CategoryHint:
+            knownHints.category = value.toString();
+            break;
+        case UserRemovableHint:
+            knownHints.userRemovable = value.toBool();
+            break;
+        case HiddenHint:
+            knownHints.hidden = value.toBool();
+            break;
+        case OriginHint:
+            knownHints.origin = value.toString();
+            break;
+        case OwnerHint:
+            knownHints.owner = value.toString();
+            break;
+        case MaxContentLinesHint:
+            knownHints.maxContentLines = value.toInt();
+            break;
+        case RestoredHint:
+            knownHints.restored = value.toBool();
+            break;
+        }
+    }
+
+    if (knownHints.icon.isEmpty()) {
+        knownHints.icon = imagePath;
+    }
+
+    uint changes = 0;
+    if (knownHints.icon != knownHints_.icon) {
+        changes |= IconChange;
+    }
+    if (timestamp != timestamp_) {
+        changes |= TimestampChange;
+    }
+    if (knownHints.previewIcon != knownHints_.previewIcon) {
+        changes |= PreviewIconChange;
     }
+    if (knownHints.previewSummary != knownHints_.previewSummary) {
+        changes |= PreviewSummaryChange;
+    }
+    if (knownHints.previewBody != knownHints_.previewBody) {
+        changes |= PreviewBodyChange;
+    }
+    if (knownHints.urgency != knownHints_.urgency) {
+        changes |= UrgencyChange;
+    }
+    if (knownHints.itemCount != knownHints_.itemCount) {
+        changes |= ItemCountChange;
+    }
+    if (priority != priority_) {
+        changes |= PriorityChange;
+    }
+    if (knownHints.category != knownHints_.category) {
+        changes |= CategoryChange;
+    }
+    if (knownHints.userRemovable != knownHints_.userRemovable) {
+        changes |= UserRemovableChange;
+    }
+
+    knownHints_ = knownHints;
+    priority_ = priority;
+    timestamp_ = timestamp;
+
+    return changes;
 }
 
 QDBusArgument &operator<<(QDBusArgument &argument, const LipstickNotification &notification)
@@ -396,8 +553,6 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, LipstickNotificat
     argument >> notification.expireTimeout_;
     argument.endStructure();
 
-    notification.priority_ = notification.hints_.value(NotificationManager::HINT_PRIORITY).toInt();
-    notification.timestamp_ = notification.hints_.value(NotificationManager::HINT_TIMESTAMP).toDateTime().toMSecsSinceEpoch();
     notification.updateHintValues();
 
     return argument;
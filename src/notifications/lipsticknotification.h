@@ -236,7 +236,46 @@ signals:
     void userRemovableChanged();
 
 private:
-    void updateHintValues();
+    //! Properties which may change when the hints change
+    enum HintChange {
+        IconChange = 1 << 0,
+        TimestampChange = 1 << 1,
+        PreviewIconChange = 1 << 2,
+        PreviewSummaryChange = 1 << 3,
+        PreviewBodyChange = 1 << 4,
+        UrgencyChange = 1 << 5,
+        ItemCountChange = 1 << 6,
+        PriorityChange = 1 << 7,
+        CategoryChange = 1 << 8,
+        UserRemovableChange = 1 << 9
+    };
+
+    /*!
+     * Parses the hints into the hint values and the values of the well-known hints.
+     *
+     * \return a mask of the HintChange values for the properties that changed
+     */
+    uint updateHintValues();
+
+    //! Values of the well-known hints which are represented by other properties
+    struct KnownHints
+    {
+        KnownHints() : urgency(0), itemCount(0), userRemovable(true), hidden(false), maxContentLines(0), restored(false) {}
+
+        QString icon;
+        QString previewIcon;
+        QString previewSummary;
+        QString previewBody;
+        int urgency;
+        int itemCount;
+        QString category;
+        bool userRemovable;
+        bool hidden;
+        QString origin;
+        QString owner;
+        int maxContentLines;
+        bool restored;
+    };
 
     //! Name of the application sending the notification
     QString appName_;
@@ -263,6 +302,9 @@ private:
     //! Expiration timeout for the notification
     int expireTimeout_;
 
+    //! Values of the well-known hints, parsed when the hints are set
+    KnownHints knownHints_;
+
     // Cached values for speeding up comparisons:
     int priority_;
     quint64 timestamp_;
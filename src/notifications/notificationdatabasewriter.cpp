@@ -0,0 +1,231 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include "notificationdatabasewriter.h"
+
+// Define this if you'd like to see debug messages from the notification manager
+#ifdef DEBUG_NOTIFICATIONS
+#define NOTIFICATIONS_DEBUG(things) qDebug() << Q_FUNC_INFO << things
+#else
+#define NOTIFICATIONS_DEBUG(things)
+#endif
+
+NotificationDatabaseWriter::NotificationDatabaseWriter(const QString &connectionName, const QString &databaseName, QObject *parent) :
+    QThread(parent),
+    connectionName(connectionName),
+    databaseName(databaseName),
+    queuedCount(0),
+    executedCount(0),
+    uncommitted(false),
+    committed(true),
+    openFailed(false)
+{
+}
+
+NotificationDatabaseWriter::~NotificationDatabaseWriter()
+{
+    if (isRunning()) {
+        flush();
+
+        {
+            QMutexLocker locker(&mutex);
+            enqueue(Command(Command::Stop));
+        }
+        wait();
+    }
+}
+
+void NotificationDatabaseWriter::execSQL(const QString &command, const QVariantList &args)
+{
+    QMutexLocker locker(&mutex);
+    enqueue(Command(Command::Exec, command, args));
+}
+
+void NotificationDatabaseWriter::execBatchSQL(const QString &command, const QVariantList &columns)
+{
+    QMutexLocker locker(&mutex);
+    enqueue(Command(Command::ExecBatch, command, columns));
+}
+
+void NotificationDatabaseWriter::commit()
+{
+    QMutexLocker locker(&mutex);
+    if (uncommitted) {
+        enqueue(Command(Command::Commit));
+    }
+}
+
+void NotificationDatabaseWriter::flush()
+{
+    QMutexLocker locker(&mutex);
+    if (!isRunning()) {
+        return;
+    }
+
+    if (uncommitted) {
+        enqueue(Command(Command::Commit));
+    }
+
+    const quint64 target(queuedCount);
+    while (executedCount < target) {
+        executedCondition.wait(&mutex);
+    }
+}
+
+void NotificationDatabaseWriter::enqueue(const Command &command)
+{
+    queue.enqueue(command);
+    ++queuedCount;
+
+    if (command.type == Command::Exec || command.type == Command::ExecBatch) {
+        uncommitted = true;
+    } else if (command.type == Command::Commit) {
+        uncommitted = false;
+    }
+
+    queueCondition.wakeOne();
+}
+
+void NotificationDatabaseWriter::run()
+{
+    bool stopped = false;
+    while (!stopped) {
+        QQueue<Command> commands;
+        {
+            QMutexLocker locker(&mutex);
+            while (queue.isEmpty()) {
+                queueCondition.wait(&mutex);
+            }
+
+            // Take all the queued commands at once to keep the lock short
+            commands.swap(queue);
+        }
+
+        foreach (const Command &command, commands) {
+            if (command.type == Command::Stop) {
+                stopped = true;
+            } else if (!stopped) {
+                execute(command);
+            }
+        }
+
+        QMutexLocker locker(&mutex);
+        executedCount += commands.count();
+        executedCondition.wakeAll();
+    }
+
+    closeDatabase();
+}
+
+void NotificationDatabaseWriter::execute(const Command &command)
+{
+    if (!openDatabase()) {
+        return;
+    }
+
+    if (command.type == Command::Commit) {
+        // Any aditional rules about when database commits are allowed can be added here
+        if (!committed) {
+            database.commit();
+            committed = true;
+        }
+        return;
+    }
+
+    if (committed) {
+        committed = false;
+        database.transaction();
+    }
+
+    QSqlQuery *query = preparedQuery(command.command);
+    if (!query) {
+        return;
+    }
+
+    foreach (const QVariant &arg, command.args) {
+        query->addBindValue(arg);
+    }
+
+    if (command.type == Command::ExecBatch) {
+        query->execBatch();
+    } else {
+        query->exec();
+    }
+
+    if (query->lastError().isValid()) {
+        NOTIFICATIONS_DEBUG(command.command << command.args << query->lastError());
+    }
+}
+
+bool NotificationDatabaseWriter::openDatabase()
+{
+    if (database.isOpen()) {
+        return true;
+    }
+    if (openFailed) {
+        // The failure has been reported already, adding the connection again would not help
+        return false;
+    }
+
+    database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    database.setDatabaseName(databaseName);
+    if (!database.open()) {
+        qWarning() << "Unable to open notification database, notifications will not be stored:" << databaseName << database.lastError().text();
+        openFailed = true;
+        return false;
+    }
+
+    // Set up the database mode to write-ahead locking to improve performance
+    QSqlQuery(database).exec("PRAGMA journal_mode=WAL");
+    return true;
+}
+
+void NotificationDatabaseWriter::closeDatabase()
+{
+    // Prepared queries must not outlive the connection
+    qDeleteAll(preparedQueries);
+    preparedQueries.clear();
+
+    if (database.isOpen()) {
+        if (!committed) {
+            database.commit();
+            committed = true;
+        }
+        database.close();
+    }
+    database = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+QSqlQuery *NotificationDatabaseWriter::preparedQuery(const QString &command)
+{
+    QHash<QString, QSqlQuery *>::const_iterator it = preparedQueries.constFind(command);
+    if (it != preparedQueries.constEnd()) {
+        return it.value();
+    }
+
+    QSqlQuery *query = new QSqlQuery(database);
+    if (!query->prepare(command)) {
+        NOTIFICATIONS_DEBUG(command << query->lastError());
+        delete query;
+        return 0;
+    }
+
+    preparedQueries.insert(command, query);
+    return query;
+}
@@ -0,0 +1,161 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef NOTIFICATIONDATABASEWRITER_H
+#define NOTIFICATIONDATABASEWRITER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QSqlDatabase>
+#include <QThread>
+#include <QVariantList>
+#include <QWaitCondition>
+
+class QSqlQuery;
+
+/*!
+ * \class NotificationDatabaseWriter
+ *
+ * \brief Writes notification data to the database in a thread of its own.
+ *
+ * Commands are executed in the order they were queued, using a database
+ * connection owned by the writer thread. The connection is opened when the
+ * first command is executed. If it cannot be opened, the failure is reported
+ * once and the commands are dropped. Commands queued before the thread is
+ * started are kept until it is.
+ */
+class NotificationDatabaseWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * Creates a notification database writer.
+     *
+     * \param connectionName the name of the database connection to be used by the writer
+     * \param databaseName the path of the database file
+     * \param parent the parent object
+     */
+    NotificationDatabaseWriter(const QString &connectionName, const QString &databaseName, QObject *parent = 0);
+
+    //! Writes any pending modifications and stops the writer thread.
+    virtual ~NotificationDatabaseWriter();
+
+    /*!
+     * Queues a SQL command. A new transaction is started if none is active currently,
+     * otherwise the command goes to the active transaction.
+     *
+     * \param command the SQL command
+     * \param args list of values to be bound to the positional placeholders ('?' -character) in the command.
+     */
+    void execSQL(const QString &command, const QVariantList &args = QVariantList());
+
+    /*!
+     * Queues a SQL command to be executed once for each row of the given values, as a single batch.
+     *
+     * \param command the SQL command
+     * \param columns list of value lists, one for each positional placeholder in the command. All lists must have the same length.
+     */
+    void execBatchSQL(const QString &command, const QVariantList &columns);
+
+    //! Queues the commit of the current transaction, if any.
+    void commit();
+
+    /*!
+     * Commits the current transaction and waits until all commands queued before
+     * the call have been executed. Returns immediately if the writer is not running.
+     */
+    void flush();
+
+protected:
+    //! \reimp
+    virtual void run();
+    //! \reimp_end
+
+private:
+    struct Command
+    {
+        enum Type {
+            Exec,
+            ExecBatch,
+            Commit,
+            Stop
+        };
+
+        Command(Type type = Exec, const QString &command = QString(), const QVariantList &args = QVariantList()) : type(type), command(command), args(args) {}
+
+        Type type;
+        QString command;
+        QVariantList args;
+    };
+
+    //! Adds a command to the queue. The mutex must be held by the caller.
+    void enqueue(const Command &command);
+
+    //! Executes a command. Called in the writer thread only.
+    void execute(const Command &command);
+
+    //! Opens the database connection of the writer thread, unless it is open already or failed to open.
+    bool openDatabase();
+
+    //! Closes the database connection of the writer thread.
+    void closeDatabase();
+
+    //! Returns a prepared query for the given SQL command, or 0 if it could not be prepared.
+    QSqlQuery *preparedQuery(const QString &command);
+
+    //! The name of the database connection
+    QString connectionName;
+
+    //! The path of the database file
+    QString databaseName;
+
+    //! Protects the queue and the counters
+    QMutex mutex;
+
+    //! Signalled when commands are added to the queue
+    QWaitCondition queueCondition;
+
+    //! Signalled when commands have been executed
+    QWaitCondition executedCondition;
+
+    //! Commands waiting to be executed
+    QQueue<Command> queue;
+
+    //! Number of commands queued so far
+    quint64 queuedCount;
+
+    //! Number of commands executed so far
+    quint64 executedCount;
+
+    //! Whether commands have been queued since the last commit was queued
+    bool uncommitted;
+
+    // The following are only accessed in the writer thread
+
+    //! The database connection of the writer thread
+    QSqlDatabase database;
+
+    //! Prepared queries keyed by their SQL command
+    QHash<QString, QSqlQuery *> preparedQueries;
+
+    //! Whether the current database transaction has been committed to the database
+    bool committed;
+
+    //! Whether opening the database connection has failed
+    bool openFailed;
+};
+
+#endif // NOTIFICATIONDATABASEWRITER_H
@@ -13,6 +13,7 @@
 **
 ****************************************************************************/
 
+#include <algorithm>
 #include "notificationmanager.h"
 #include "notificationlistmodel.h"
 
@@ -30,6 +31,25 @@ void sortNotifications(QList<QObject *> &notifications)
 
 }
 
+NotificationListModel::SortKey::SortKey(LipstickNotification *notification) :
+    priority(notification->priority()),
+    timestamp(notification->internalTimestamp()),
+    id(notification->replacesId())
+{
+}
+
+bool NotificationListModel::SortKey::operator<(const SortKey &other) const
+{
+    // Same order as for the notifications: by descending priority, timestamp and ID
+    if (priority != other.priority) {
+        return priority > other.priority;
+    }
+    if (timestamp != other.timestamp) {
+        return timestamp > other.timestamp;
+    }
+    return id > other.id;
+}
+
 NotificationListModel::NotificationListModel(QObject *parent) :
     QObjectListModel(parent),
     m_populated(false)
@@ -39,6 +59,7 @@ NotificationListModel::NotificationListModel(QObject *parent) :
     connect(NotificationManager::instance(), SIGNAL(notificationRemoved(uint)), this, SLOT(removeNotification(uint)));
     connect(NotificationManager::instance(), SIGNAL(notificationsRemoved(const QList<uint> &)), this, SLOT(removeNotifications(const QList<uint> &)));
     connect(this, SIGNAL(clearRequested()), NotificationManager::instance(), SLOT(removeUserRemovableNotifications()));
+    connect(this, SIGNAL(itemRemoved(QObject*)), this, SLOT(removeSortKey(QObject*)));
 
     QTimer::singleShot(0, this, SLOT(init()));
 }
@@ -70,6 +91,7 @@ void NotificationListModel::init()
 
         sortNotifications(initialNotifications);
         addItems(initialNotifications);
+        rebuildSortKeys();
     }
 
     m_populated = true;
@@ -81,46 +103,143 @@ void NotificationListModel::updateNotification(uint id)
     LipstickNotification *notification = NotificationManager::instance()->notification(id);
 
     if (notification != 0) {
-        int currentIndex = indexOf(notification);
+        int currentIndex = rowOf(notification);
         if (notificationShouldBeShown(notification)) {
             // Place the notifications in the model latest first, moving existing notifications if necessary
             int newIndex = indexFor(notification);
+            const SortKey key(notification);
             if (currentIndex < 0) {
                 insertItem(newIndex, notification);
+                m_sortKeys.insert(newIndex, key);
             } else if (newIndex == currentIndex || newIndex == (currentIndex + 1)) {
                 // If the new index is the existing index + 1, there is no actual movement
                 update(currentIndex);
+                m_sortKeys[currentIndex] = key;
             } else {
                 // QObjectListModel::move works like QList::move - the insertion is performed after the extraction
                 if (newIndex > currentIndex) {
                     newIndex -= 1;
                 }
                 move(currentIndex, newIndex);
+                m_sortKeys.remove(currentIndex);
+                m_sortKeys.insert(newIndex, key);
             }
+            m_placedSortKeys.insert(notification, key);
         } else if (currentIndex >= 0) {
-            removeItem(notification);
+            // The sort key is removed when the removal is reported
+            removeItem(currentIndex);
         }
     }
 }
 
 void NotificationListModel::updateNotifications(const QList<uint> &ids)
 {
-    foreach (uint id, ids)
-        updateNotification(id);
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    // Modifications reported during the same event loop iteration are applied to the model together
+    const bool scheduled = !m_pendingUpdateIds.isEmpty();
+    foreach (uint id, ids) {
+        m_pendingUpdateIds.insert(id);
+    }
+    if (!scheduled) {
+        QTimer::singleShot(0, this, SLOT(applyPendingUpdates()));
+    }
 }
 
-int NotificationListModel::indexFor(LipstickNotification *notification)
+void NotificationListModel::applyPendingUpdates()
 {
-    for (int index = 0; index < itemCount(); index++) {
-        LipstickNotification *notificationAtIndex = static_cast<LipstickNotification *>(get(index));
-        if (notification->replacesId() == notificationAtIndex->replacesId()) {
+    const QSet<uint> ids(m_pendingUpdateIds);
+    m_pendingUpdateIds.clear();
+
+    ensureSortKeys();
+
+    typedef QPair<SortKey, QObject *> Entry;
+    QSet<QObject *> modified;
+    QSet<QObject *> shownBefore;
+    QList<Entry> shown;
+    foreach (uint id, ids) {
+        LipstickNotification *notification = NotificationManager::instance()->notification(id);
+        if (notification == 0 || modified.contains(notification)) {
+            continue;
+        }
+
+        modified.insert(notification);
+        if (m_placedSortKeys.contains(notification)) {
+            shownBefore.insert(notification);
+        }
+        if (notificationShouldBeShown(notification)) {
+            shown.append(qMakePair(SortKey(notification), static_cast<QObject *>(notification)));
+        }
+    }
+
+    if (modified.isEmpty()) {
+        return;
+    }
+
+    struct Comparator {
+        bool operator()(const Entry &lhs, const Entry &rhs) const {
+            return lhs.first < rhs.first;
+        }
+    } cmp;
+    std::sort(shown.begin(), shown.end(), cmp);
+
+    // The unmodified notifications keep their order, so the modified ones only need to be merged in.
+    // This places them as indexFor() would, as the order is fixed to the sort key order.
+    const QList<QObject *> &current(*getList());
+    QList<QObject *> items;
+    QVector<SortKey> keys;
+    QList<int> changedRows;
+    items.reserve(current.count() + shown.count());
+    keys.reserve(current.count() + shown.count());
+
+    QList<Entry>::const_iterator it = shown.constBegin(), end = shown.constEnd();
+    for (int row = 0; row < current.count(); ++row) {
+        QObject *item(current.at(row));
+        if (modified.contains(item)) {
             continue;
         }
-        if (*notification < *notificationAtIndex) {
-            return index;
+
+        const SortKey &key(m_sortKeys.at(row));
+        for ( ; it != end && it->first < key; ++it) {
+            if (shownBefore.contains(it->second)) {
+                changedRows.append(items.count());
+            }
+            items.append(it->second);
+            keys.append(it->first);
+        }
+        items.append(item);
+        keys.append(key);
+    }
+    for ( ; it != end; ++it) {
+        if (shownBefore.contains(it->second)) {
+            changedRows.append(items.count());
         }
+        items.append(it->second);
+        keys.append(it->first);
     }
-    return itemCount();
+
+    synchronizeList(items);
+
+    m_sortKeys = keys;
+    m_placedSortKeys.clear();
+    for (int row = 0; row < items.count(); ++row) {
+        m_placedSortKeys.insert(items.at(row), keys.at(row));
+    }
+
+    foreach (int row, changedRows) {
+        update(row);
+    }
+}
+
+int NotificationListModel::indexFor(LipstickNotification *notification)
+{
+    ensureSortKeys();
+
+    // The first notification which sorts after the given one. If that is the notification
+    // itself the following index is just as good, as neither means any movement.
+    return std::upper_bound(m_sortKeys.constBegin(), m_sortKeys.constEnd(), SortKey(notification)) - m_sortKeys.constBegin();
 }
 
 void NotificationListModel::refreshModel()
@@ -157,3 +276,57 @@ bool NotificationListModel::notificationShouldBeShown(LipstickNotification *noti
 {
     return !notification->hidden() && (!notification->body().isEmpty() || !notification->summary().isEmpty());
 }
+
+void NotificationListModel::removeSortKey(QObject *item)
+{
+    // The item may already be partially destroyed, so it is only used as a key
+    QHash<QObject *, SortKey>::iterator it = m_placedSortKeys.find(item);
+    if (it != m_placedSortKeys.end()) {
+        QVector<SortKey>::iterator keyIt = std::lower_bound(m_sortKeys.begin(), m_sortKeys.end(), it.value());
+        if (keyIt != m_sortKeys.end() && keyIt->id == it.value().id) {
+            m_sortKeys.erase(keyIt);
+        }
+        m_placedSortKeys.erase(it);
+    }
+}
+
+int NotificationListModel::rowOf(LipstickNotification *notification)
+{
+    ensureSortKeys();
+
+    // Find the notification with the key it was placed with, as its properties may have changed since
+    QHash<QObject *, SortKey>::const_iterator it = m_placedSortKeys.constFind(notification);
+    if (it == m_placedSortKeys.constEnd()) {
+        return -1;
+    }
+
+    QVector<SortKey>::const_iterator keyIt = std::lower_bound(m_sortKeys.constBegin(), m_sortKeys.constEnd(), it.value());
+    const int row = keyIt - m_sortKeys.constBegin();
+    if (keyIt != m_sortKeys.constEnd() && keyIt->id == it.value().id && getList()->at(row) == notification) {
+        return row;
+    }
+
+    // The rows have been reordered behind the back of the model
+    rebuildSortKeys();
+    return indexOf(notification);
+}
+
+void NotificationListModel::ensureSortKeys()
+{
+    if (m_sortKeys.count() != itemCount()) {
+        rebuildSortKeys();
+    }
+}
+
+void NotificationListModel::rebuildSortKeys()
+{
+    m_sortKeys.clear();
+    m_placedSortKeys.clear();
+
+    m_sortKeys.reserve(itemCount());
+    foreach (QObject *item, *getList()) {
+        const SortKey key(static_cast<LipstickNotification *>(item));
+        m_sortKeys.append(key);
+        m_placedSortKeys.insert(item, key);
+    }
+}
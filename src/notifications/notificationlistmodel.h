@@ -18,6 +18,9 @@
 
 #include "qobjectlistmodel.h"
 #include "lipstickglobal.h"
+#include <QHash>
+#include <QSet>
+#include <QVector>
 
 class LipstickNotification;
 
@@ -42,6 +45,8 @@ private slots:
     void updateNotifications(const QList<uint> &ids);
     void removeNotification(uint id);
     void removeNotifications(const QList<uint> &ids);
+    void removeSortKey(QObject *item);
+    void applyPendingUpdates();
 
 protected:
     /*!
@@ -56,12 +61,17 @@ protected:
 
     /*!
      * Checks where the notification should be placed so that the
-     * notifications in the model are ordered by timestamp.
+     * notifications in the model are ordered by descending priority,
+     * timestamp and ID.
+     *
+     * The order is fixed: the model looks up the rows of its notifications
+     * with a binary search over their sort keys, which only works as long as
+     * the rows are in this order. This function is therefore not virtual.
      *
      * \param notification the notification for which to get the position
      * \return index in which the notification shoud be placed
      */
-    virtual int indexFor(LipstickNotification *notification);
+    int indexFor(LipstickNotification *notification);
 
     void refreshModel();
 
@@ -70,8 +80,40 @@ protected:
 private:
     Q_DISABLE_COPY(NotificationListModel)
 
+    //! Sort key of a notification, as the notification was when it was placed in the model
+    struct SortKey
+    {
+        SortKey() : priority(0), timestamp(0), id(0) {}
+        explicit SortKey(LipstickNotification *notification);
+
+        //! Returns true if this key sorts before the other key
+        bool operator<(const SortKey &other) const;
+
+        int priority;
+        quint64 timestamp;
+        uint id;
+    };
+
+    //! Returns the row of the notification in the model, or -1 if it is not in the model
+    int rowOf(LipstickNotification *notification);
+
+    //! Rebuilds the sort keys if they no longer match the rows of the model
+    void ensureSortKeys();
+
+    //! Rebuilds the sort keys from the notifications in the model
+    void rebuildSortKeys();
+
     bool m_populated;
 
+    //! Sort keys of the notifications in the order of the rows of the model
+    QVector<SortKey> m_sortKeys;
+
+    //! Sort keys of the notifications in the model, for finding their rows
+    QHash<QObject *, SortKey> m_placedSortKeys;
+
+    //! IDs of the modified notifications waiting to be applied to the model together
+    QSet<uint> m_pendingUpdateIds;
+
 #ifdef UNIT_TEST
     friend class Ut_NotificationListModel;
 #endif
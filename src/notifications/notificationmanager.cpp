@@ -14,6 +14,7 @@
 ****************************************************************************/
 
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDebug>
 #include <QSqlDatabase>
 #include <QSqlError>
@@ -23,9 +24,12 @@
 #include <mremoteaction.h>
 #include <mdesktopentry.h>
 #include <sys/statfs.h>
+#include <algorithm>
+#include <functional>
 #include <limits>
 #include "androidprioritystore.h"
 #include "categorydefinitionstore.h"
+#include "notificationdatabasewriter.h"
 #include "notificationmanageradaptor.h"
 #include "notificationmanager.h"
 
@@ -93,6 +97,58 @@ const int DefaultNotificationPriority = 50;
 const int CommitDelay = 10 * 1000;
 const int PublicationDelay = 1000;
 
+// Version 2 adds the expiration time index, version 3 moves the hints to the notifications table
+const int CurrentSchemaVersion = 3;
+
+// Version of the serialization format of the hints
+const QDataStream::Version HintStreamVersion = QDataStream::Qt_5_0;
+
+typedef QPair<qint64, uint> ExpirationEntry;
+
+QString databaseDirectory()
+{
+    return "/home/nemo" + QString(PRIVILEGED_DATA_PATH) + QDir::separator() + "Notifications";
+}
+
+QString databaseFileName()
+{
+    return databaseDirectory() + "/notifications.db";
+}
+
+QByteArray serializeHints(const QVariantHash &hints)
+{
+    QVariantHash storedHints;
+    QVariantHash::const_iterator it = hints.constBegin(), end = hints.constEnd();
+    for ( ; it != end; ++it) {
+        // Custom types can not be streamed; store them as strings like the database driver would
+        if (it.value().userType() >= QMetaType::User) {
+            storedHints.insert(it.key(), it.value().toString());
+        } else {
+            storedHints.insert(it.key(), it.value());
+        }
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(HintStreamVersion);
+    stream << storedHints;
+    return data;
+}
+
+QVariantHash deserializeHints(const QByteArray &data)
+{
+    QVariantHash hints;
+    if (!data.isEmpty()) {
+        QDataStream stream(data);
+        stream.setVersion(HintStreamVersion);
+        stream >> hints;
+        if (stream.status() != QDataStream::Ok) {
+            hints.clear();
+        }
+    }
+    return hints;
+}
+
 QPair<QString, QString> processProperties(uint pid)
 {
     // Cache resolution of process name to properties:
@@ -163,7 +219,7 @@ NotificationManager::NotificationManager(QObject *parent, bool owner) :
     categoryDefinitionStore(new CategoryDefinitionStore(CATEGORY_DEFINITION_FILE_DIRECTORY, MAX_CATEGORY_DEFINITION_FILES, this)),
     androidPriorityStore(new AndroidPriorityStore(ANDROID_PRIORITY_DEFINITION_PATH, this)),
     database(new QSqlDatabase),
-    committed(true),
+    databaseWriter(0),
     nextExpirationTime(0)
 {
     if (owner) {
@@ -196,7 +252,8 @@ NotificationManager::NotificationManager(QObject *parent, bool owner) :
 
 NotificationManager::~NotificationManager()
 {
-    database->commit();
+    // Waits for the pending modifications to be written
+    delete databaseWriter;
     delete database;
 }
 
@@ -210,6 +267,20 @@ QList<uint> NotificationManager::notificationIds() const
     return notifications.keys();
 }
 
+uint NotificationManager::notificationId(LipstickNotification *notification) const
+{
+    // The ID is stored in the notification, but the notification may already have been removed or replaced
+    const uint id = notification->replacesId();
+    return notifications.value(id) == notification ? id : 0;
+}
+
+void NotificationManager::flushDatabase()
+{
+    if (databaseWriter) {
+        databaseWriter->flush();
+    }
+}
+
 QStringList NotificationManager::GetCapabilities()
 {
     return QStringList() << "body"
@@ -351,12 +422,14 @@ uint NotificationManager::Notify(const QString &appName, uint replacesId, const
 
 void NotificationManager::DeleteNotification(uint id)
 {
-    // Remove the notification, its actions and its hints from database
+    // Remove the notification and its actions from database
     const QVariantList params(QVariantList() << id);
     execSQL(QString("DELETE FROM notifications WHERE id=?"), params);
     execSQL(QString("DELETE FROM actions WHERE id=?"), params);
-    execSQL(QString("DELETE FROM hints WHERE id=?"), params);
     execSQL(QString("DELETE FROM expiration WHERE id=?"), params);
+
+    // Any entry left in the expiration queue becomes stale
+    expirationTimes.remove(id);
 }
 
 void NotificationManager::CloseNotification(uint id, NotificationClosedReason closeReason)
@@ -371,6 +444,7 @@ void NotificationManager::CloseNotification(uint id, NotificationClosedReason cl
 
         // Mark the notification to be destroyed
         removedNotifications.insert(notifications.take(id));
+        unindexNotification(id);
     }
 }
 
@@ -397,6 +471,7 @@ void NotificationManager::CloseNotifications(const QList<uint> &ids, Notificatio
 
             // Mark the notification to be destroyed
             removedNotifications.insert(notifications.take(id));
+            unindexNotification(id);
         }
     }
 }
@@ -411,11 +486,12 @@ void NotificationManager::MarkNotificationDisplayed(uint id)
             NOTIFICATIONS_DEBUG("REMOVED transient:" << id);
         } else {
             const int timeout(notification->expireTimeout());
-            if (timeout > 0) {
-                // Insert the timeout into the expiration table, or leave the existing value if already present
+            if (timeout > 0 && !expirationTimes.contains(id)) {
+                // Insert the timeout into the expiration table, unless already present
                 const qint64 currentTime(QDateTime::currentDateTimeUtc().toMSecsSinceEpoch());
                 const qint64 expireAt(currentTime + timeout);
                 execSQL(QString("INSERT OR IGNORE INTO expiration(id, expire_at) VALUES(?, ?)"), QVariantList() << id << expireAt);
+                enqueueExpiration(id, expireAt);
 
                 if (nextExpirationTime == 0 || (expireAt < nextExpirationTime)) {
                     // This will be the next notification to expire - update the timer
@@ -439,13 +515,13 @@ QString NotificationManager::GetServerInformation(QString &name, QString &vendor
 
 NotificationList NotificationManager::GetNotifications(const QString &owner)
 {
+    // List the notifications in the order they were created
+    QList<uint> ids(ownerIds.value(owner).toList());
+    std::sort(ids.begin(), ids.end());
+
     QList<LipstickNotification *> notificationList;
-    QHash<uint, LipstickNotification *>::const_iterator it = notifications.constBegin(), end = notifications.constEnd();
-    for ( ; it != end; ++it) {
-        LipstickNotification *notification = it.value();
-        if (notification->owner() == owner) {
-            notificationList.append(notification);
-        }
+    foreach (uint id, ids) {
+        notificationList.append(notifications.value(id));
     }
 
     return NotificationList(notificationList);
@@ -470,27 +546,14 @@ uint NotificationManager::nextAvailableNotificationID()
 
 void NotificationManager::removeNotificationsWithCategory(const QString &category)
 {
-    QList<uint> ids;
-    QHash<uint, LipstickNotification *>::const_iterator it = notifications.constBegin(), end = notifications.constEnd();
-    for ( ; it != end; ++it) {
-        LipstickNotification *notification(it.value());
-        if (notification->category() == category) {
-            ids.append(it.key());
-        }
-    }
-    CloseNotifications(ids);
+    CloseNotifications(categoryIds.value(category).toList());
 }
 
 void NotificationManager::updateNotificationsWithCategory(const QString &category)
 {
     QList<LipstickNotification *> categoryNotifications;
-
-    QHash<uint, LipstickNotification *>::const_iterator it = notifications.constBegin(), end = notifications.constEnd();
-    for ( ; it != end; ++it) {
-        LipstickNotification *notification(it.value());
-        if (notification->category() == category) {
-            categoryNotifications.append(notification);
-        }
+    foreach (uint id, categoryIds.value(category)) {
+        categoryNotifications.append(notifications.value(id));
     }
 
     foreach (LipstickNotification *notification, categoryNotifications) {
@@ -567,17 +630,23 @@ void NotificationManager::publish(const LipstickNotification *notification, uint
         DeleteNotification(id);
     }
 
-    // Add the notification, its actions and its hints to the database
-    execSQL("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?)", QVariantList() << id << notification->appName() << notification->appIcon() << notification->summary() << notification->body() << notification->expireTimeout());
-    foreach (const QString &action, notification->actions()) {
-        execSQL("INSERT INTO actions VALUES (?, ?)", QVariantList() << id << action);
-    }
-    const QVariantHash hints(notification->hints());
-    QVariantHash::const_iterator hit = hints.constBegin(), hend = hints.constEnd();
-    for ( ; hit != hend; ++hit) {
-        execSQL("INSERT INTO hints VALUES (?, ?, ?)", QVariantList() << id << hit.key() << hit.value());
+    // Add the notification along with its hints and its actions to the database. Actions are
+    // written as a batch so that the number of statements does not depend on their count.
+    execSQL("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)", QVariantList() << id << notification->appName() << notification->appIcon() << notification->summary() << notification->body() << notification->expireTimeout() << serializeHints(notification->hints()));
+
+    const QStringList actions(notification->actions());
+    if (!actions.isEmpty()) {
+        QVariantList actionIds;
+        QVariantList actionValues;
+        foreach (const QString &action, actions) {
+            actionIds.append(id);
+            actionValues.append(action);
+        }
+        execBatchSQL("INSERT INTO actions VALUES (?, ?)", QVariantList() << QVariant(actionIds) << QVariant(actionValues));
     }
 
+    indexNotification(id, notification);
+
     NOTIFICATIONS_DEBUG("PUBLISH:" << notification->appName() << notification->appIcon() << notification->summary() << notification->body() << notification->actions() << notification->hints() << notification->expireTimeout() << "->" << id);
     modifiedIds.insert(id);
     if (!modificationTimer.isActive()) {
@@ -588,24 +657,72 @@ void NotificationManager::publish(const LipstickNotification *notification, uint
     }
 }
 
+void NotificationManager::indexNotification(uint id, const LipstickNotification *notification)
+{
+    unindexNotification(id);
+
+    IndexEntry entry;
+    entry.category = notification->category();
+    entry.owner = notification->owner();
+    const QVariant userRemovable(notification->hints().value(HINT_USER_REMOVABLE));
+    entry.userRemovable = !userRemovable.isValid() || userRemovable.toBool();
+
+    categoryIds[entry.category].insert(id);
+    ownerIds[entry.owner].insert(id);
+    if (entry.userRemovable) {
+        userRemovableIds.insert(id);
+    }
+    indexEntries.insert(id, entry);
+}
+
+void NotificationManager::unindexNotification(uint id)
+{
+    QHash<uint, IndexEntry>::iterator it = indexEntries.find(id);
+    if (it == indexEntries.end()) {
+        return;
+    }
+
+    const IndexEntry &entry(it.value());
+    QHash<QString, QSet<uint> >::iterator categoryIt = categoryIds.find(entry.category);
+    if (categoryIt != categoryIds.end()) {
+        categoryIt->remove(id);
+        if (categoryIt->isEmpty()) {
+            categoryIds.erase(categoryIt);
+        }
+    }
+    QHash<QString, QSet<uint> >::iterator ownerIt = ownerIds.find(entry.owner);
+    if (ownerIt != ownerIds.end()) {
+        ownerIt->remove(id);
+        if (ownerIt->isEmpty()) {
+            ownerIds.erase(ownerIt);
+        }
+    }
+    userRemovableIds.remove(id);
+    indexEntries.erase(it);
+}
+
 void NotificationManager::restoreNotifications(bool update)
 {
     if (connectToDatabase()) {
         if (checkTableValidity()) {
+            // Any modifications made while restoring are queued until the writer is started
+            databaseWriter = new NotificationDatabaseWriter(QString(metaObject()->className()) + "Writer", databaseFileName(), this);
             fetchData(update);
-        } else {
-            database->close();
+            databaseWriter->start();
         }
+
+        // The writer thread uses a connection of its own from now on
+        database->close();
     }
 }
 
 bool NotificationManager::connectToDatabase()
 {
-    QString databasePath = "/home/nemo" + QString(PRIVILEGED_DATA_PATH) + QDir::separator() + "Notifications";
+    QString databasePath = databaseDirectory();
     if (!QDir::root().exists(databasePath)) {
         QDir::root().mkpath(databasePath);
     }
-    QString databaseName = databasePath + "/notifications.db";
+    QString databaseName = databaseFileName();
 
     *database = QSqlDatabase::addDatabase("QSQLITE", metaObject()->className());
     database->setDatabaseName(databaseName);
@@ -658,8 +775,8 @@ bool NotificationManager::checkTableValidity()
     bool result = true;
     bool recreateNotificationsTable = false;
     bool recreateActionsTable = false;
-    bool recreateHintsTable = false;
     bool recreateExpirationTable = false;
+    bool migrateHints = false;
 
     const int databaseVersion(schemaVersion());
 
@@ -668,12 +785,7 @@ bool NotificationManager::checkTableValidity()
         qWarning() << "Removing obsolete notifications";
         recreateNotificationsTable = true;
         recreateActionsTable = true;
-        recreateHintsTable = true;
         recreateExpirationTable = true;
-
-        if (!setSchemaVersion(1)) {
-            qWarning() << "Unable to set database schema version!";
-        }
     } else {
         // Check that the notifications table schema is as expected
         QSqlTableModel notificationsTableModel(0, *database);
@@ -685,19 +797,15 @@ bool NotificationManager::checkTableValidity()
                                       notificationsTableModel.fieldIndex("body") == -1 ||
                                       notificationsTableModel.fieldIndex("expire_timeout") == -1);
 
+        // Hints used to be stored in a table of their own
+        migrateHints = (!recreateNotificationsTable && notificationsTableModel.fieldIndex("hints") == -1);
+
         // Check that the actions table schema is as expected
         QSqlTableModel actionsTableModel(0, *database);
         actionsTableModel.setTable("actions");
         recreateActionsTable = (actionsTableModel.fieldIndex("id") == -1 ||
                                 actionsTableModel.fieldIndex("action") == -1);
 
-        // Check that the hints table schema is as expected
-        QSqlTableModel hintsTableModel(0, *database);
-        hintsTableModel.setTable("hints");
-        recreateHintsTable = (hintsTableModel.fieldIndex("id") == -1 ||
-                              hintsTableModel.fieldIndex("hint") == -1 ||
-                              hintsTableModel.fieldIndex("value") == -1);
-
         // Check that the expiration table schema is as expected
         QSqlTableModel expirationTableModel(0, *database);
         expirationTableModel.setTable("expiration");
@@ -705,22 +813,35 @@ bool NotificationManager::checkTableValidity()
                                    expirationTableModel.fieldIndex("expire_at") == -1);
     }
 
+    if (migrateHints && !migrateHintsTable()) {
+        qWarning() << "Unable to migrate notification hints";
+        recreateNotificationsTable = true;
+    }
+
     if (recreateNotificationsTable) {
-        result &= recreateTable("notifications", "id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER");
+        result &= recreateTable("notifications", "id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER, hints BLOB");
+        QSqlQuery(*database).exec("DROP TABLE IF EXISTS hints");
     }
 
     if (recreateActionsTable) {
         result &= recreateTable("actions", "id INTEGER, action TEXT, PRIMARY KEY(id, action)");
     }
 
-    if (recreateHintsTable) {
-        result &= recreateTable("hints", "id INTEGER, hint TEXT, value TEXT, PRIMARY KEY(id, hint)");
-    }
-
     if (recreateExpirationTable) {
         result &= recreateTable("expiration", "id INTEGER PRIMARY KEY, expire_at INTEGER");
     }
 
+    if (recreateExpirationTable || databaseVersion < CurrentSchemaVersion) {
+        // Dropping the expiration table also drops its index
+        result &= QSqlQuery(*database).exec("CREATE INDEX IF NOT EXISTS expiration_expire_at ON expiration(expire_at)");
+    }
+
+    if (databaseVersion < CurrentSchemaVersion) {
+        if (!setSchemaVersion(CurrentSchemaVersion)) {
+            qWarning() << "Unable to set database schema version!";
+        }
+    }
+
     return result;
 }
 
@@ -764,44 +885,63 @@ bool NotificationManager::recreateTable(const QString &tableName, const QString
     return result;
 }
 
-void NotificationManager::fetchData(bool update)
+bool NotificationManager::migrateHintsTable()
 {
-    // Gather actions for each notification
-    QSqlQuery actionsQuery("SELECT * FROM actions", *database);
-    QSqlRecord actionsRecord = actionsQuery.record();
-    int actionsTableIdFieldIndex = actionsRecord.indexOf("id");
-    int actionsTableActionFieldIndex = actionsRecord.indexOf("action");
-    QHash<uint, QStringList> actions;
-    while (actionsQuery.next()) {
-        const uint id = actionsQuery.value(actionsTableIdFieldIndex).toUInt();
-        actions[id].append(actionsQuery.value(actionsTableActionFieldIndex).toString());
-    }
+    bool result = false;
+
+    if (database->isOpen()) {
+        // Either all of the migration is done or none of it
+        database->transaction();
 
-    // Gather hints for each notification
-    QSqlQuery hintsQuery("SELECT * FROM hints", *database);
-    QSqlRecord hintsRecord = hintsQuery.record();
-    int hintsTableIdFieldIndex = hintsRecord.indexOf("id");
-    int hintsTableHintFieldIndex = hintsRecord.indexOf("hint");
-    int hintsTableValueFieldIndex = hintsRecord.indexOf("value");
-    QHash<uint, QVariantHash> hints;
-    while (hintsQuery.next()) {
-        const uint id = hintsQuery.value(hintsTableIdFieldIndex).toUInt();
-        const QString hintName(hintsQuery.value(hintsTableHintFieldIndex).toString());
-        const QVariant hintValue(hintsQuery.value(hintsTableValueFieldIndex));
-
-        QVariant value;
-        if (hintName == HINT_TIMESTAMP) {
-            // Timestamps in the DB are already UTC but not marked as such, so they will
-            // be converted again unless specified to be UTC
-            QDateTime timestamp(QDateTime::fromString(hintValue.toString(), Qt::ISODate));
-            timestamp.setTimeSpec(Qt::UTC);
-            value = timestamp.toString(Qt::ISODate);
+        result = QSqlQuery(*database).exec("ALTER TABLE notifications ADD COLUMN hints BLOB");
+
+        QSqlTableModel hintsTableModel(0, *database);
+        hintsTableModel.setTable("hints");
+        if (result && hintsTableModel.fieldIndex("id") != -1 && hintsTableModel.fieldIndex("hint") != -1 && hintsTableModel.fieldIndex("value") != -1) {
+            QSqlQuery hintsQuery("SELECT * FROM hints", *database);
+            QSqlRecord hintsRecord = hintsQuery.record();
+            int hintsTableIdFieldIndex = hintsRecord.indexOf("id");
+            int hintsTableHintFieldIndex = hintsRecord.indexOf("hint");
+            int hintsTableValueFieldIndex = hintsRecord.indexOf("value");
+            QHash<uint, QVariantHash> hints;
+            while (hintsQuery.next()) {
+                const uint id = hintsQuery.value(hintsTableIdFieldIndex).toUInt();
+                const QString hintName(hintsQuery.value(hintsTableHintFieldIndex).toString());
+                QVariant hintValue(hintsQuery.value(hintsTableValueFieldIndex));
+
+                if (hintName == HINT_TIMESTAMP) {
+                    // Timestamps in the hints table are UTC but not necessarily marked as such,
+                    // so they would be converted again unless specified to be UTC
+                    QDateTime timestamp(QDateTime::fromString(hintValue.toString(), Qt::ISODate));
+                    timestamp.setTimeSpec(Qt::UTC);
+                    hintValue = timestamp.toString(Qt::ISODate);
+                }
+                hints[id].insert(hintName, hintValue);
+            }
+
+            QSqlQuery updateQuery(*database);
+            result = updateQuery.prepare("UPDATE notifications SET hints=? WHERE id=?");
+            QHash<uint, QVariantHash>::const_iterator it = hints.constBegin(), end = hints.constEnd();
+            for ( ; result && it != end; ++it) {
+                updateQuery.addBindValue(serializeHints(it.value()));
+                updateQuery.addBindValue(it.key());
+                result = updateQuery.exec();
+            }
+        }
+
+        if (result) {
+            QSqlQuery(*database).exec("DROP TABLE IF EXISTS hints");
+            database->commit();
         } else {
-            value = hintValue;
+            database->rollback();
         }
-        hints[id].insert(hintName, value);
     }
 
+    return result;
+}
+
+void NotificationManager::fetchData(bool update)
+{
     // Gather expiration times for displayed notifications
     QSqlQuery expirationQuery("SELECT * FROM expiration", *database);
     QSqlRecord expirationRecord = expirationQuery.record();
@@ -817,11 +957,11 @@ void NotificationManager::fetchData(bool update)
     QList<LipstickNotification *> activeNotifications;
     QList<uint> transientIds;
     QList<uint> expiredIds;
-    qint64 nextTimeout = std::numeric_limits<qint64>::max();
-    bool unexpiredRemaining = false;
 
-    // Create the notifications
-    QSqlQuery notificationsQuery("SELECT * FROM notifications", *database);
+    // The notifications and actions are both read in ID order, so that the actions
+    // of each notification can be merged in as the notification is read, without
+    // collecting the whole table in memory first
+    QSqlQuery notificationsQuery("SELECT * FROM notifications ORDER BY id", *database);
     QSqlRecord notificationsRecord = notificationsQuery.record();
     int notificationsTableIdFieldIndex = notificationsRecord.indexOf("id");
     int notificationsTableAppNameFieldIndex = notificationsRecord.indexOf("app_name");
@@ -829,6 +969,15 @@ void NotificationManager::fetchData(bool update)
     int notificationsTableSummaryFieldIndex = notificationsRecord.indexOf("summary");
     int notificationsTableBodyFieldIndex = notificationsRecord.indexOf("body");
     int notificationsTableExpireTimeoutFieldIndex = notificationsRecord.indexOf("expire_timeout");
+    int notificationsTableHintsFieldIndex = notificationsRecord.indexOf("hints");
+
+    // Actions are kept in insertion order within each notification, as they are identifier/name pairs
+    QSqlQuery actionsQuery("SELECT * FROM actions ORDER BY id, rowid", *database);
+    QSqlRecord actionsRecord = actionsQuery.record();
+    int actionsTableIdFieldIndex = actionsRecord.indexOf("id");
+    int actionsTableActionFieldIndex = actionsRecord.indexOf("action");
+    bool actionsRemaining = actionsQuery.next();
+
     while (notificationsQuery.next()) {
         const uint id = notificationsQuery.value(notificationsTableIdFieldIndex).toUInt();
         QString appName = notificationsQuery.value(notificationsTableAppNameFieldIndex).toString();
@@ -836,10 +985,19 @@ void NotificationManager::fetchData(bool update)
         QString summary = notificationsQuery.value(notificationsTableSummaryFieldIndex).toString();
         QString body = notificationsQuery.value(notificationsTableBodyFieldIndex).toString();
         int expireTimeout = notificationsQuery.value(notificationsTableExpireTimeoutFieldIndex).toInt();
+        QVariantHash notificationHints = deserializeHints(notificationsQuery.value(notificationsTableHintsFieldIndex).toByteArray());
+
+        // Rows of notifications which no longer exist are skipped
+        QStringList notificationActions;
+        for ( ; actionsRemaining; actionsRemaining = actionsQuery.next()) {
+            const uint actionId = actionsQuery.value(actionsTableIdFieldIndex).toUInt();
+            if (actionId > id) {
+                break;
+            } else if (actionId == id) {
+                notificationActions.append(actionsQuery.value(actionsTableActionFieldIndex).toString());
+            }
+        }
 
-        const QStringList &notificationActions = actions[id];
-
-        QVariantHash &notificationHints = hints[id];
         if (notificationHints.value(HINT_TRANSIENT).toBool()) {
             // This notification was transient, it should not be restored
             NOTIFICATIONS_DEBUG("TRANSIENT AT RESTORE:" << appName << appIcon << summary << body << notificationActions << notificationHints << expireTimeout << "->" << id);
@@ -856,13 +1014,13 @@ void NotificationManager::fetchData(bool update)
             if (expiry <= currentTime) {
                 expired = true;
             } else {
-                nextTimeout = qMin(expiry, nextTimeout);
-                unexpiredRemaining = true;
+                enqueueExpiration(id, expiry);
             }
         }
 
         LipstickNotification *notification = new LipstickNotification(appName, id, appIcon, summary, body, notificationActions, notificationHints, expireTimeout, this);
         notifications.insert(id, notification);
+        indexNotification(id, notification);
 
         if (id > previousNotificationID) {
             // Use the highest notification ID found as the previous notification ID
@@ -893,7 +1051,7 @@ void NotificationManager::fetchData(bool update)
             const QVariant userRemovable = n->hints().value(HINT_USER_REMOVABLE);
             if (!userRemovable.isValid() || userRemovable.toBool()) {
                 const uint id = n->replacesId();
-                NOTIFICATIONS_DEBUG("CULLED AT RESTORE:" << n->appName() << n->appIcon() << n->summary() << n->body() << actions[id] << hints[id] << n->expireTimeout() << "->" << id);
+                NOTIFICATIONS_DEBUG("CULLED AT RESTORE:" << n->appName() << n->appIcon() << n->summary() << n->body() << n->actions() << n->hints() << n->expireTimeout() << "->" << id);
                 expiredIds.append(id);
 
                 if (--cullCount == 0) {
@@ -906,11 +1064,7 @@ void NotificationManager::fetchData(bool update)
     if (update) {
         CloseNotifications(expiredIds, NotificationExpired);
 
-        nextExpirationTime = unexpiredRemaining ? nextTimeout : 0;
-        if (nextExpirationTime) {
-            const qint64 nextTriggerInterval(nextExpirationTime - currentTime);
-            expirationTimer.start(static_cast<int>(std::min<qint64>(nextTriggerInterval, std::numeric_limits<int>::max())));
-        }
+        scheduleExpiration(currentTime);
     }
 
     QList<uint> restoredIds;
@@ -919,7 +1073,7 @@ void NotificationManager::fetchData(bool update)
         connect(n, SIGNAL(actionInvoked(QString)), this, SLOT(invokeAction(QString)), Qt::QueuedConnection);
         connect(n, SIGNAL(removeRequested()), this, SLOT(removeNotificationIfUserRemovable()), Qt::QueuedConnection);
 
-        NOTIFICATIONS_DEBUG("RESTORED:" << n->appName() << n->appIcon() << n->summary() << n->body() << actions[id] << hints[id] << n->expireTimeout() << "->" << id);
+        NOTIFICATIONS_DEBUG("RESTORED:" << n->appName() << n->appIcon() << n->summary() << n->body() << n->actions() << n->hints() << n->expireTimeout() << "->" << id);
         restoredIds.append(id);
     }
     if (!restoredIds.isEmpty())
@@ -932,10 +1086,8 @@ void NotificationManager::fetchData(bool update)
 
 void NotificationManager::commit()
 {
-    // Any aditional rules about when database commits are allowed can be added here
-    if (!committed) {
-        database->commit();
-        committed = true;
+    if (databaseWriter) {
+        databaseWriter->commit();
     }
 
     qDeleteAll(removedNotifications);
@@ -944,27 +1096,22 @@ void NotificationManager::commit()
 
 void NotificationManager::execSQL(const QString &command, const QVariantList &args)
 {
-    if (!database->isOpen()) {
+    if (!databaseWriter) {
         return;
     }
 
-    if (committed) {
-        committed = false;
-        database->transaction();
-    }
+    databaseWriter->execSQL(command, args);
 
-    QSqlQuery query(*database);
-    query.prepare(command);
+    databaseCommitTimer.start();
+}
 
-    foreach(const QVariant &arg, args) {
-        query.addBindValue(arg);
+void NotificationManager::execBatchSQL(const QString &command, const QVariantList &columns)
+{
+    if (!databaseWriter) {
+        return;
     }
 
-    query.exec();
-
-    if (query.lastError().isValid()) {
-        NOTIFICATIONS_DEBUG(command << args << query.lastError());
-    }
+    databaseWriter->execBatchSQL(command, columns);
 
     databaseCommitTimer.start();
 }
@@ -973,7 +1120,7 @@ void NotificationManager::invokeAction(const QString &action)
 {
     LipstickNotification *notification = qobject_cast<LipstickNotification *>(sender());
     if (notification != 0) {
-        uint id = notifications.key(notification, 0);
+        const uint id = notificationId(notification);
         if (id > 0) {
             QString remoteAction = notification->hints().value(QString(HINT_REMOTE_ACTION_PREFIX) + action).toString();
             if (!remoteAction.isEmpty()) {
@@ -1006,7 +1153,7 @@ void NotificationManager::removeNotificationIfUserRemovable(uint id)
     if (id == 0) {
         LipstickNotification *notification = qobject_cast<LipstickNotification *>(sender());
         if (notification != 0) {
-            id = notifications.key(notification, 0);
+            id = notificationId(notification);
         }
     }
 
@@ -1027,7 +1174,9 @@ void NotificationManager::removeNotificationIfUserRemovable(uint id)
             emit notificationRemoved(id);
 
             // Mark the notification as hidden
-            execSQL("INSERT INTO hints VALUES (?, ?, ?)", QVariantList() << id << HINT_HIDDEN << true);
+            QVariantHash hints(notification->hints());
+            hints.insert(HINT_HIDDEN, true);
+            execSQL("UPDATE notifications SET hints=? WHERE id=?", QVariantList() << serializeHints(hints) << id);
         }
     }
 }
@@ -1036,31 +1185,60 @@ void NotificationManager::expire()
 {
     const qint64 currentTime(QDateTime::currentDateTimeUtc().toMSecsSinceEpoch());
     QList<uint> expiredIds;
-    qint64 nextTimeout = std::numeric_limits<qint64>::max();
-    bool unexpiredRemaining = false;
 
-    QSqlQuery expirationQuery("SELECT * FROM expiration", *database);
-    QSqlRecord expirationRecord = expirationQuery.record();
-    int expirationTableIdFieldIndex = expirationRecord.indexOf("id");
-    int expirationTableExpireAtFieldIndex = expirationRecord.indexOf("expire_at");
-    while (expirationQuery.next()) {
-        const uint id = expirationQuery.value(expirationTableIdFieldIndex).toUInt();
-        const qint64 expiry = expirationQuery.value(expirationTableExpireAtFieldIndex).value<qint64>();
+    // Only the entries which are due need to be examined
+    while (!expirationQueue.isEmpty() && expirationQueue.first().first <= currentTime) {
+        const ExpirationEntry entry(expirationQueue.first());
+        std::pop_heap(expirationQueue.begin(), expirationQueue.end(), std::greater<ExpirationEntry>());
+        expirationQueue.removeLast();
 
-        if (expiry <= currentTime) {
-            expiredIds.append(id);
-        } else {
-            nextTimeout = qMin(expiry, nextTimeout);
-            unexpiredRemaining = true;
+        QHash<uint, qint64>::iterator it = expirationTimes.find(entry.second);
+        if (it != expirationTimes.end() && it.value() == entry.first) {
+            expirationTimes.erase(it);
+            expiredIds.append(entry.second);
         }
     }
 
     CloseNotifications(expiredIds, NotificationExpired);
 
-    nextExpirationTime = unexpiredRemaining ? nextTimeout : 0;
+    scheduleExpiration(currentTime);
+}
+
+void NotificationManager::enqueueExpiration(uint id, qint64 expireAt)
+{
+    expirationTimes.insert(id, expireAt);
+
+    if (expirationQueue.count() >= 2 * expirationTimes.count()) {
+        // Most of the queue is made of stale entries of closed notifications, so rebuild it
+        expirationQueue.clear();
+        QHash<uint, qint64>::const_iterator it = expirationTimes.constBegin(), end = expirationTimes.constEnd();
+        for ( ; it != end; ++it) {
+            expirationQueue.append(qMakePair(it.value(), it.key()));
+        }
+        std::make_heap(expirationQueue.begin(), expirationQueue.end(), std::greater<ExpirationEntry>());
+    } else {
+        expirationQueue.append(qMakePair(expireAt, id));
+        std::push_heap(expirationQueue.begin(), expirationQueue.end(), std::greater<ExpirationEntry>());
+    }
+}
+
+void NotificationManager::scheduleExpiration(qint64 currentTime)
+{
+    while (!expirationQueue.isEmpty()) {
+        const ExpirationEntry &entry(expirationQueue.first());
+        QHash<uint, qint64>::const_iterator it = expirationTimes.constFind(entry.second);
+        if (it != expirationTimes.constEnd() && it.value() == entry.first) {
+            break;
+        }
+
+        std::pop_heap(expirationQueue.begin(), expirationQueue.end(), std::greater<ExpirationEntry>());
+        expirationQueue.removeLast();
+    }
+
+    nextExpirationTime = expirationQueue.isEmpty() ? 0 : expirationQueue.first().first;
     if (nextExpirationTime) {
         const qint64 nextTriggerInterval(nextExpirationTime - currentTime);
-        expirationTimer.start(static_cast<int>(std::min<qint64>(nextTriggerInterval, std::numeric_limits<int>::max())));
+        expirationTimer.start(static_cast<int>(qBound<qint64>(0, nextTriggerInterval, std::numeric_limits<int>::max())));
     }
 }
 
@@ -1077,24 +1255,22 @@ void NotificationManager::reportModifications()
 void NotificationManager::removeUserRemovableNotifications()
 {
     QList<uint> closableNotifications;
+    QList<uint> uncloseableNotifications;
 
-    // Find any closable notifications we can close as a batch
-    QHash<uint, LipstickNotification *>::const_iterator it = notifications.constBegin(), end = notifications.constEnd();
-    for ( ; it != end; ++it) {
-        LipstickNotification *notification(it.value());
-        QVariant userRemovable = notification->hints().value(HINT_USER_REMOVABLE);
-        if (!userRemovable.isValid() || userRemovable.toBool()) {
-            QVariant userCloseable = notification->hints().value(HINT_USER_CLOSEABLE);
-            if (!userCloseable.isValid() || userCloseable.toBool()) {
-                closableNotifications.append(it.key());
-            }
+    // Find any closable notifications we can close as a batch. Only the user removable notifications need to be examined.
+    foreach (uint id, userRemovableIds) {
+        QVariant userCloseable = notifications.value(id)->hints().value(HINT_USER_CLOSEABLE);
+        if (!userCloseable.isValid() || userCloseable.toBool()) {
+            closableNotifications.append(id);
+        } else {
+            uncloseableNotifications.append(id);
         }
     }
 
     CloseNotifications(closableNotifications, NotificationDismissedByUser);
 
     // Remove any remaining notifications
-    foreach(uint id, notifications.keys()) {
+    foreach (uint id, uncloseableNotifications) {
         removeNotificationIfUserRemovable(id);
     }
 }
@@ -21,10 +21,12 @@
 #include <QObject>
 #include <QTimer>
 #include <QSet>
+#include <QVector>
 #include <QDBusContext>
 
 class AndroidPriorityStore;
 class CategoryDefinitionStore;
+class NotificationDatabaseWriter;
 class QSqlDatabase;
 
 /*!
@@ -150,6 +152,12 @@ public:
      */
     QList<uint> notificationIds() const;
 
+    /*!
+     * Commits all pending modifications to the database and waits until they
+     * have been written. Does nothing if the database is not available.
+     */
+    void flushDatabase();
+
     /*!
      * Returns an array of strings. Each string describes an optional capability
      * implemented by the server. Refer to the Desktop Notification Specifications for
@@ -346,6 +354,14 @@ private:
      */
     uint nextAvailableNotificationID();
 
+    /*!
+     * Returns the ID of a notification managed by the notification manager.
+     *
+     * \param notification the notification
+     * \return the ID of the notification, or 0 if the notification is not managed by the notification manager
+     */
+    uint notificationId(LipstickNotification *notification) const;
+
     /*!
      * Returns all key-value pairs in the requested category definition.
      *
@@ -363,6 +379,12 @@ private:
      */
     void publish(const LipstickNotification *notification, uint replacesId);
 
+    //! Adds a notification to the category, owner and user removability indexes, replacing any earlier entry
+    void indexNotification(uint id, const LipstickNotification *notification);
+
+    //! Removes a notification from the category, owner and user removability indexes
+    void unindexNotification(uint id);
+
     //! Restores the notifications from a database on the disk
     void restoreNotifications(bool update);
 
@@ -426,23 +448,77 @@ private:
      */
     bool recreateTable(const QString &tableName, const QString &definition);
 
+    /*!
+     * Moves the hints of the stored notifications from the hints table, which
+     * has a row for each hint, to the hints column of the notifications table.
+     *
+     * \return \c true if the hints were migrated, \c false otherwise
+     */
+    bool migrateHintsTable();
+
     //! Fills the notifications hash table with data from the database
     void fetchData(bool update);
 
     /*!
-     * Executes a SQL command in the database. Starts a new transaction if none is active currently, otherwise
+     * Adds a notification to the in-memory expiration queue.
+     *
+     * \param id the ID of the notification
+     * \param expireAt the expiration time of the notification, relative to epoch
+     */
+    void enqueueExpiration(uint id, qint64 expireAt);
+
+    /*!
+     * Discards stale entries from the head of the expiration queue and
+     * restarts the expiration timer for the next notification to expire.
+     *
+     * \param currentTime the current time, relative to epoch
+     */
+    void scheduleExpiration(qint64 currentTime);
+
+    /*!
+     * Queues a SQL command to be executed by the database writer. Starts a new transaction if none is active currently, otherwise
      * the command goes to the active transaction. Restarts the transaction commit timer.
      * \param command the SQL command
      * \param args list of values to be bound to the positional placeholders ('?' -character) in the command.
      */
     void execSQL(const QString &command, const QVariantList &args = QVariantList());
 
+    /*!
+     * Queues a SQL command to be executed once for each row of the given values, as a single batch.
+     * Transactions are handled as in execSQL().
+     * \param command the SQL command
+     * \param columns list of value lists, one for each positional placeholder in the command. All lists must have the same length.
+     */
+    void execBatchSQL(const QString &command, const QVariantList &columns);
+
     //! The singleton notification manager instance
     static NotificationManager *instance_;
 
     //! Hash of all notifications keyed by notification IDs
     QHash<uint, LipstickNotification*> notifications;
 
+    //! Indexed properties of a notification, as they were when the notification was indexed
+    struct IndexEntry
+    {
+        IndexEntry() : userRemovable(false) {}
+
+        QString category;
+        QString owner;
+        bool userRemovable;
+    };
+
+    //! Indexed properties of the notifications keyed by notification IDs
+    QHash<uint, IndexEntry> indexEntries;
+
+    //! IDs of the notifications keyed by their category
+    QHash<QString, QSet<uint> > categoryIds;
+
+    //! IDs of the notifications keyed by their owner
+    QHash<QString, QSet<uint> > ownerIds;
+
+    //! IDs of the notifications which can be removed by the user
+    QSet<uint> userRemovableIds;
+
     //! Notifications waiting to be destroyed
     QSet<LipstickNotification *> removedNotifications;
 
@@ -455,11 +531,11 @@ private:
     //! The Android application priority store
     AndroidPriorityStore *androidPriorityStore;
 
-    //! Database for the notifications
+    //! Database for the notifications, used for restoring the notifications only
     QSqlDatabase *database;
 
-    //! Whether the current database transaction has been committed to the database
-    bool committed;
+    //! Writes the modifications to the database in a separate thread
+    NotificationDatabaseWriter *databaseWriter;
 
     //! Timer for triggering the commit of the current database transaction
     QTimer databaseCommitTimer;
@@ -470,6 +546,12 @@ private:
     //! Next trigger time for the expirationTimer, relative to epoch
     qint64 nextExpirationTime;
 
+    //! Expiration times of displayed notifications keyed by notification IDs
+    QHash<uint, qint64> expirationTimes;
+
+    //! Min-heap of expiration times and notification IDs. Entries not matching expirationTimes are stale.
+    QVector<QPair<qint64, uint> > expirationQueue;
+
     //! IDs of notifications modified since the last report
     QSet<uint> modifiedIds;
 
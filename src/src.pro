@@ -65,8 +65,13 @@ dbus_policy.path = /etc/dbus-1/system.d
 HEADERS += \
     $$PUBLICHEADERS \
     3rdparty/synchronizelists.h \
+    utilities/directorywatcher.h \
+    components/launcherentrycache.h \
+    components/launcherpositionstore.h \
     notifications/notificationmanageradaptor.h \
+    notifications/notificationdatabasewriter.h \
     notifications/categorydefinitionstore.h \
+    notifications/categorydefinitionbundle.h \
     notifications/batterynotifier.h \
     notifications/lowbatterynotifier.h \
     notifications/diskspacenotifier.h \
@@ -99,16 +104,21 @@ SOURCES += \
     lipstickqmlpath.cpp \
     utilities/qobjectlistmodel.cpp \
     utilities/closeeventeater.cpp \
+    utilities/directorywatcher.cpp \
     components/launcheritem.cpp \
     components/launchermodel.cpp \
     components/launcherwatchermodel.cpp \
     components/launchermonitor.cpp \
     components/launcherdbus.cpp \
     components/launcherfoldermodel.cpp \
+    components/launcherentrycache.cpp \
+    components/launcherpositionstore.cpp \
     notifications/notificationmanager.cpp \
     notifications/notificationmanageradaptor.cpp \
+    notifications/notificationdatabasewriter.cpp \
     notifications/lipsticknotification.cpp \
     notifications/categorydefinitionstore.cpp \
+    notifications/categorydefinitionbundle.cpp \
     notifications/notificationlistmodel.cpp \
     notifications/notificationpreviewpresenter.cpp \
     notifications/batterynotifier.cpp \
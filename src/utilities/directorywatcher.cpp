@@ -0,0 +1,219 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QVarLengthArray>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "directorywatcher.h"
+
+//! The events watched in each directory
+static const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_ONLYDIR;
+
+//! How long changes are collected before they are reported, in milliseconds
+static const int REPORT_DELAY = 100;
+
+DirectoryWatcher *DirectoryWatcher::instance_ = 0;
+
+DirectoryWatcher *DirectoryWatcher::instance()
+{
+    if (instance_ == 0) {
+        instance_ = new DirectoryWatcher(qApp);
+    }
+    return instance_;
+}
+
+DirectoryWatcher::DirectoryWatcher(QObject *parent) :
+    QObject(parent),
+    inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+    notifier(0)
+{
+    if (inotifyFd < 0) {
+        qWarning() << "DirectoryWatcher: inotify is not available, file changes will not be noticed";
+    } else if (QAbstractEventDispatcher::instance() != 0) {
+        notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+    }
+
+    // Changes are reported at most REPORT_DELAY milliseconds after the first one,
+    // even if more keep coming in
+    reportTimer.setSingleShot(true);
+    reportTimer.setInterval(REPORT_DELAY);
+    connect(&reportTimer, SIGNAL(timeout()), this, SLOT(reportChanges()));
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if (inotifyFd >= 0) {
+        delete notifier;
+        ::close(inotifyFd);
+    }
+
+    if (instance_ == this) {
+        instance_ = 0;
+    }
+}
+
+bool DirectoryWatcher::addDirectory(const QString &path)
+{
+    const QString directory(QDir::cleanPath(path));
+
+    QHash<QString, Watch>::iterator it = watches.find(directory);
+    if (it != watches.end()) {
+        ++it->count;
+        return it->descriptor >= 0;
+    }
+
+    Watch watch;
+    watch.descriptor = inotifyFd >= 0 ? inotify_add_watch(inotifyFd, QFile::encodeName(directory).constData(), WATCH_MASK) : -1;
+    watch.count = 1;
+    watches.insert(directory, watch);
+
+    if (watch.descriptor >= 0) {
+        // The same directory may be reached through different paths, in which case the watch is shared
+        watchDirectories.insert(watch.descriptor, directory);
+    }
+
+    return watch.descriptor >= 0;
+}
+
+void DirectoryWatcher::removeDirectory(const QString &path)
+{
+    const QString directory(QDir::cleanPath(path));
+
+    QHash<QString, Watch>::iterator it = watches.find(directory);
+    if (it == watches.end() || --it->count > 0) {
+        return;
+    }
+
+    const int descriptor = it->descriptor;
+    watches.erase(it);
+    pendingChanges.remove(directory);
+
+    if (descriptor >= 0) {
+        watchDirectories.remove(descriptor, directory);
+        if (!watchDirectories.contains(descriptor)) {
+            inotify_rm_watch(inotifyFd, descriptor);
+        }
+    }
+}
+
+void DirectoryWatcher::readEvents()
+{
+    int available = 0;
+    if (ioctl(inotifyFd, FIONREAD, &available) < 0 || available <= 0) {
+        return;
+    }
+
+    QVarLengthArray<char, 4096> buffer(available);
+    const ssize_t length = ::read(inotifyFd, buffer.data(), available);
+    if (length <= 0) {
+        return;
+    }
+
+    const char *data = buffer.constData();
+    const char *end = data + length;
+    while (data + sizeof(struct inotify_event) <= end) {
+        const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(data);
+        data += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            qWarning() << "DirectoryWatcher: inotify event queue overflowed";
+            emit eventsLost();
+            continue;
+        }
+
+        if (event->mask & IN_IGNORED) {
+            // The directory was removed or unmounted, so the kernel removed the watch
+            foreach (const QString &directory, watchDirectories.values(event->wd)) {
+                watches[directory].descriptor = -1;
+            }
+            watchDirectories.remove(event->wd);
+            continue;
+        }
+
+        if ((event->mask & IN_ISDIR) || event->len == 0) {
+            continue;
+        }
+
+        const QString fileName(QFile::decodeName(event->name));
+        Change change = Modified;
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+            change = Added;
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            change = Removed;
+        }
+
+        foreach (const QString &directory, watchDirectories.values(event->wd)) {
+            addChange(directory, fileName, change);
+        }
+    }
+}
+
+void DirectoryWatcher::addChange(const QString &directory, const QString &fileName, Change change)
+{
+    QHash<QString, Change> &changes(pendingChanges[directory]);
+    QHash<QString, Change>::iterator it = changes.find(fileName);
+    if (it == changes.end()) {
+        changes.insert(fileName, change);
+    } else if (change != Modified || *it == Removed) {
+        // Modifying a file does not change the fact that it was added
+        *it = change;
+    }
+
+    if (!reportTimer.isActive()) {
+        reportTimer.start();
+    }
+}
+
+void DirectoryWatcher::reportChanges()
+{
+    QHash<QString, QHash<QString, Change> > changes;
+    changes.swap(pendingChanges);
+
+    QHash<QString, QHash<QString, Change> >::const_iterator it = changes.constBegin(), end = changes.constEnd();
+    for ( ; it != end; ++it) {
+        const QString &directory(it.key());
+        const QString prefix(directory.endsWith(QLatin1Char('/')) ? directory : directory + QLatin1Char('/'));
+
+        QStringList added;
+        QStringList modified;
+        QStringList removed;
+        QHash<QString, Change>::const_iterator cit = it.value().constBegin(), cend = it.value().constEnd();
+        for ( ; cit != cend; ++cit) {
+            switch (cit.value()) {
+            case Added:
+                added.append(prefix + cit.key());
+                break;
+            case Modified:
+                modified.append(prefix + cit.key());
+                break;
+            case Removed:
+                removed.append(prefix + cit.key());
+                break;
+            }
+        }
+
+        // A slot may have stopped watching the directory while the changes were being reported
+        if (watches.contains(directory)) {
+            emit filesChanged(directory, added, modified, removed);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <QHash>
+#include <QMultiHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/*!
+ * \class DirectoryWatcher
+ *
+ * \brief Watches directories for changes to the files in them.
+ *
+ * A single inotify instance is shared by all the users of the watcher, with
+ * one watch for each watched directory regardless of how many files there
+ * are in it. Changes to the files are collected for a short while and then
+ * reported together, one signal per directory, so that a burst of changes
+ * such as a package installation is delivered at once.
+ *
+ * Each change is reported as the final state of the file: a file which was
+ * created and then modified is reported as added, and a file which was
+ * replaced by renaming another file over it is reported as added even if it
+ * existed before.
+ */
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Returns the directory watcher instance.
+    static DirectoryWatcher *instance();
+
+    /*!
+     * Starts watching a directory. Directories are reference counted, so each
+     * call must be balanced with a call to removeDirectory().
+     *
+     * \param path the path of the directory
+     * \return \c true if the directory is being watched, \c false otherwise
+     */
+    bool addDirectory(const QString &path);
+
+    /*!
+     * Stops watching a directory once it has been removed as many times as it
+     * was added.
+     *
+     * \param path the path of the directory
+     */
+    void removeDirectory(const QString &path);
+
+signals:
+    /*!
+     * Sent when files in a watched directory have changed.
+     *
+     * \param directory the cleaned path of the directory
+     * \param added the paths of the files that were added to the directory
+     * \param modified the paths of the files that were modified
+     * \param removed the paths of the files that were removed from the directory
+     */
+    void filesChanged(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
+
+    //! Sent when the kernel has dropped events, so the watched directories should be listed again.
+    void eventsLost();
+
+private slots:
+    //! Reads the available events from the inotify instance
+    void readEvents();
+
+    //! Reports the changes collected since the previous report
+    void reportChanges();
+
+private:
+    explicit DirectoryWatcher(QObject *parent = 0);
+    virtual ~DirectoryWatcher();
+
+    //! The kinds of changes reported for a file
+    enum Change {
+        Added,
+        Modified,
+        Removed
+    };
+
+    struct Watch
+    {
+        int descriptor;
+        int count;
+    };
+
+    //! Records a change to a file in a directory
+    void addChange(const QString &directory, const QString &fileName, Change change);
+
+    //! The directory watcher instance
+    static DirectoryWatcher *instance_;
+
+    //! The inotify instance, or -1 if inotify is not available
+    int inotifyFd;
+
+    //! Notifies when there are events to be read from the inotify instance
+    QSocketNotifier *notifier;
+
+    //! Watches keyed by the directory path
+    QHash<QString, Watch> watches;
+
+    //! Directory paths keyed by the watch descriptor
+    QMultiHash<int, QString> watchDirectories;
+
+    //! Changes to be reported, keyed by directory path and file name
+    QHash<QString, QHash<QString, Change> > pendingChanges;
+
+    //! Timer for collecting changes before they are reported
+    QTimer reportTimer;
+};
+
+#endif // DIRECTORYWATCHER_H
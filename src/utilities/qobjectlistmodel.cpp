@@ -244,6 +244,8 @@ int QObjectListModel::insertRange(int index, int count, const QList<QObject *> &
     for (int i = 0; i < count; ++i) {
         QObject *item(source.at(sourceIndex + i));
         _list->insert(index + i, item);
+        // An item moved by inserting it before removing it is already connected
+        connect(item, SIGNAL(destroyed()), this, SLOT(removeDestroyedItem()), Qt::UniqueConnection);
         int removedIndex = _removed.indexOf(item);
         if (removedIndex != -1) {
             _removed.removeAt(removedIndex);
@@ -265,9 +267,11 @@ int QObjectListModel::removeRange(int index, int count)
         QObject *item(_list->at(index));
         int insertedIndex = _inserted.indexOf(item);
         if (insertedIndex != -1) {
+            // Moved by inserting it first, so the item is still in the list
             _inserted.removeAt(insertedIndex);
         } else {
             _removed.append(item);
+            disconnect(item, SIGNAL(destroyed()), this, SLOT(removeDestroyedItem()));
         }
         _list->removeAt(index);
     }
@@ -31,6 +31,7 @@ class CategoryDefinitionStoreStub : public StubBase {
   virtual QHash<QString, QString> categoryParameters(const QString &category);
   virtual void updateCategoryDefinitionFileList();
   virtual void updateCategoryDefinitionFile(const QString &path);
+  virtual void updateCategoryDefinitionFiles(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
 };
 
 // 2. IMPLEMENT STUB
@@ -87,6 +88,15 @@ void CategoryDefinitionStoreStub::updateCategoryDefinitionFile(const QString &pa
   stubMethodEntered("updateCategoryDefinitionFile",params);
 }
 
+void CategoryDefinitionStoreStub::updateCategoryDefinitionFiles(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed) {
+  QList<ParameterBase*> params;
+  params.append( new Parameter<const QString & >(directory));
+  params.append( new Parameter<const QStringList & >(added));
+  params.append( new Parameter<const QStringList & >(modified));
+  params.append( new Parameter<const QStringList & >(removed));
+  stubMethodEntered("updateCategoryDefinitionFiles",params);
+}
+
 
 
 // 3. CREATE A STUB INSTANCE
@@ -99,6 +109,9 @@ CategoryDefinitionStore::CategoryDefinitionStore(const QString &categoryDefiniti
   gCategoryDefinitionStoreStub->CategoryDefinitionStoreConstructor(categoryDefinitionsPath, maxStoredCategoryDefinitions, parent);
 }
 
+CategoryDefinitionStore::~CategoryDefinitionStore() {
+}
+
 bool CategoryDefinitionStore::categoryDefinitionExists(const QString &category) const {
   return gCategoryDefinitionStoreStub->categoryDefinitionExists(category);
 }
@@ -127,5 +140,9 @@ void CategoryDefinitionStore::updateCategoryDefinitionFile(const QString &path)
   gCategoryDefinitionStoreStub->updateCategoryDefinitionFile(path);
 }
 
+void CategoryDefinitionStore::updateCategoryDefinitionFiles(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed) {
+  gCategoryDefinitionStoreStub->updateCategoryDefinitionFiles(directory, added, modified, removed);
+}
+
 
 #endif
@@ -27,6 +27,7 @@ class NotificationManagerStub : public StubBase {
   virtual NotificationManager * instance(bool owner = true);
   virtual LipstickNotification * notification(uint id) const;
   virtual QList<uint> notificationIds() const;
+  virtual void flushDatabase();
   virtual QStringList GetCapabilities();
   virtual uint Notify(const QString &appName, uint replacesId, const QString &appIcon, const QString &summary, const QString &body, const QStringList &actions, const QVariantHash &hints, int expireTimeout);
   virtual void CloseNotification(uint id, NotificationManager::NotificationClosedReason closeReason);
@@ -65,6 +66,10 @@ QList<uint> NotificationManagerStub::notificationIds() const {
   return stubReturnValue<QList<uint>>("notificationIds");
 }
 
+void NotificationManagerStub::flushDatabase() {
+  stubMethodEntered("flushDatabase");
+}
+
 QStringList NotificationManagerStub::GetCapabilities() {
   stubMethodEntered("GetCapabilities");
   return stubReturnValue<QStringList>("GetCapabilities");
@@ -208,6 +213,10 @@ QList<uint> NotificationManager::notificationIds() const {
   return gNotificationManagerStub->notificationIds();
 }
 
+void NotificationManager::flushDatabase() {
+  gNotificationManagerStub->flushDatabase();
+}
+
 QStringList NotificationManager::GetCapabilities() {
   return gNotificationManagerStub->GetCapabilities();
 }
@@ -5,7 +5,9 @@ SUBDIRS = \
           ut_closeeventeater \
           ut_devicelock \
           ut_diskspacenotifier \
+          ut_launcherfoldermodel \
           ut_launchermodel \
+          ut_launchermonitor \
           ut_lipsticksettings \
           ut_lowbatterynotifier \
           ut_lipsticknotification \
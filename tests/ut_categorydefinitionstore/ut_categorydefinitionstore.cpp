@@ -15,8 +15,10 @@
 ****************************************************************************/
 
 #include <QtTest/QtTest>
+#include <QSettings>
 #include "ut_categorydefinitionstore.h"
 #include "categorydefinitionstore.h"
+#include "categorydefinitionbundle.h"
 
 // List of category definition files
 QStringList categoryDefinitionFilesList;
@@ -25,12 +27,6 @@ QMap<QString, QMap<QString, QString> > categoryDefinitionSettingsMap;
 // Size of the category definition file
 uint categoryDefinitionFileSize;
 
-// QFileSystemWatcher stubs
-bool QFileSystemWatcher::addPath(const QString &)
-{
-    return true;
-}
-
 // QFileInfo stubs
 bool QFileInfo::exists() const
 {
@@ -198,4 +194,124 @@ void Ut_CategoryDefinitionStore::testCategoryDefinitionUninstalling()
     QCOMPARE(store->categoryDefinitionExists("smsCategoryDefinition"), false);
 }
 
+void Ut_CategoryDefinitionStore::testCategoryDefinitionCaching()
+{
+    categoryDefinitionFilesList << "smsCategoryDefinition.conf" << "emailCategoryDefinition.conf" << "chatCategoryDefinition.conf";
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "sms-icon");
+    categoryDefinitionSettingsMap["emailCategoryDefinition"].insert("iconId", "email-icon");
+    categoryDefinitionSettingsMap["chatCategoryDefinition"].insert("iconId", "chat-icon");
+
+    store = new CategoryDefinitionStore("/categorydefinitionpath", 2);
+    QSignalSpy modifiedSpy(store, SIGNAL(categoryDefinitionModified(QString)));
+    connect(this, SIGNAL(fileChanged(QString)), store, SLOT(updateCategoryDefinitionFile(QString)));
+
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("sms-icon"));
+    QCOMPARE(store->value("emailCategoryDefinition", "iconId"), QString("email-icon"));
+
+    // Loaded category definitions are not read again until the file is modified
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "new-sms-icon");
+    QCOMPARE(store->categoryParameters("smsCategoryDefinition").value("iconId"), QString("sms-icon"));
+    emit fileChanged("/categorydefinitionpath/smsCategoryDefinition.conf");
+    QCOMPARE(modifiedSpy.count(), 1);
+    QCOMPARE(modifiedSpy.last().at(0).toString(), QString("smsCategoryDefinition"));
+    QCOMPARE(store->categoryParameters("smsCategoryDefinition").value("iconId"), QString("new-sms-icon"));
+
+    // Loading a third category definition drops the least recently used one
+    QCOMPARE(store->value("chatCategoryDefinition", "iconId"), QString("chat-icon"));
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "newer-sms-icon");
+    categoryDefinitionSettingsMap["emailCategoryDefinition"].insert("iconId", "new-email-icon");
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("new-sms-icon"));
+    QCOMPARE(store->value("emailCategoryDefinition", "iconId"), QString("new-email-icon"));
+}
+
+void Ut_CategoryDefinitionStore::testCategoryDefinitionBundle()
+{
+    categoryDefinitionFilesList << "smsCategoryDefinition.conf" << "emailCategoryDefinition.conf";
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "sms-icon");
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("feedbackId", "sound-file");
+    categoryDefinitionSettingsMap["emailCategoryDefinition"].insert("iconId", "email-icon");
+
+    // Compile the category definitions into a bundle next to the category definition directory
+    QTemporaryDir bundleDir;
+    QVERIFY(bundleDir.isValid());
+    const QString categoryDefinitionsPath(bundleDir.path() + "/categorydefinitionpath");
+    QStringList files;
+    foreach (const QString &file, categoryDefinitionFilesList) {
+        files.append(categoryDefinitionsPath + "/" + file);
+    }
+    QVERIFY(CategoryDefinitionBundle::compile(files, categoryDefinitionsPath + ".bundle"));
+
+    CategoryDefinitionBundle bundle(categoryDefinitionsPath + ".bundle");
+    QCOMPARE(bundle.isValid(), true);
+    QCOMPARE(bundle.contains("smsCategoryDefinition"), true);
+    QCOMPARE(bundle.contains("emailCategoryDefinition"), true);
+    QCOMPARE(bundle.contains("chatCategoryDefinition"), false);
+    QHash<QString, QString> parameters(bundle.categoryParameters("smsCategoryDefinition"));
+    QCOMPARE(parameters.count(), 2);
+    QCOMPARE(parameters.value("iconId"), QString("sms-icon"));
+    QCOMPARE(parameters.value("feedbackId"), QString("sound-file"));
+    QCOMPARE(bundle.categoryParameters("chatCategoryDefinition").count(), 0);
+
+    // The bundled definitions are used instead of the files, other files are read as such
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "new-sms-icon");
+    categoryDefinitionFilesList.append("chatCategoryDefinition.conf");
+    categoryDefinitionSettingsMap["chatCategoryDefinition"].insert("iconId", "chat-icon");
+    store = new CategoryDefinitionStore(categoryDefinitionsPath);
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("sms-icon"));
+    QCOMPARE(store->value("smsCategoryDefinition", "feedbackId"), QString("sound-file"));
+    QCOMPARE(store->allKeys("smsCategoryDefinition").count(), 2);
+    QCOMPARE(store->value("chatCategoryDefinition", "iconId"), QString("chat-icon"));
+    QCOMPARE(store->categoryDefinitionExists("idontexist"), false);
+
+    // Definitions whose files have been removed are not used from the bundle
+    categoryDefinitionFilesList.removeOne("emailCategoryDefinition.conf");
+    QCOMPARE(store->categoryDefinitionExists("emailCategoryDefinition"), false);
+    // Files changed since the bundle was compiled are read as such even when the
+    // change happened while no store was running, whatever their modification times
+    delete store;
+    categoryDefinitionFileSize = 200;
+    store = new CategoryDefinitionStore(categoryDefinitionsPath);
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("new-sms-icon"));
+}
+
+void Ut_CategoryDefinitionStore::testCategoryDefinitionFilesChanged()
+{
+    categoryDefinitionFilesList << "smsCategoryDefinition.conf";
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "sms-icon");
+    categoryDefinitionSettingsMap["chatCategoryDefinition"].insert("iconId", "chat-icon");
+
+    store = new CategoryDefinitionStore("/categorydefinitionpath");
+    QSignalSpy modifiedSpy(store, SIGNAL(categoryDefinitionModified(QString)));
+    QSignalSpy uninstallSpy(store, SIGNAL(categoryDefinitionUninstalled(QString)));
+    connect(this, SIGNAL(filesChanged(QString,QStringList,QStringList,QStringList)), store, SLOT(updateCategoryDefinitionFiles(QString,QStringList,QStringList,QStringList)));
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("sms-icon"));
+
+    // Added category definition files are available without listing the directory again
+    categoryDefinitionFilesList << "chatCategoryDefinition.conf";
+    emit filesChanged("/categorydefinitionpath", QStringList() << "/categorydefinitionpath/chatCategoryDefinition.conf", QStringList(), QStringList());
+    QCOMPARE(modifiedSpy.count(), 0);
+    QCOMPARE(store->value("chatCategoryDefinition", "iconId"), QString("chat-icon"));
+
+    // A file replaced by renaming another file over it is reported as added
+    categoryDefinitionSettingsMap["smsCategoryDefinition"].insert("iconId", "new-sms-icon");
+    emit filesChanged("/categorydefinitionpath", QStringList() << "/categorydefinitionpath/smsCategoryDefinition.conf", QStringList(), QStringList());
+    QCOMPARE(modifiedSpy.count(), 1);
+    QCOMPARE(modifiedSpy.last().at(0).toString(), QString("smsCategoryDefinition"));
+    QCOMPARE(store->value("smsCategoryDefinition", "iconId"), QString("new-sms-icon"));
+
+    // Other files and other directories are ignored
+    emit filesChanged("/categorydefinitionpath", QStringList() << "/categorydefinitionpath/readme.txt", QStringList(), QStringList() << "/categorydefinitionpath/unknownCategoryDefinition.conf");
+    emit filesChanged("/otherpath", QStringList(), QStringList(), QStringList() << "/otherpath/smsCategoryDefinition.conf");
+    QCOMPARE(modifiedSpy.count(), 1);
+    QCOMPARE(uninstallSpy.count(), 0);
+    QCOMPARE(store->categoryDefinitionExists("smsCategoryDefinition"), true);
+
+    // Removed category definition files are uninstalled
+    categoryDefinitionFilesList.removeOne("chatCategoryDefinition.conf");
+    emit filesChanged("/categorydefinitionpath", QStringList(), QStringList(), QStringList() << "/categorydefinitionpath/chatCategoryDefinition.conf");
+    QCOMPARE(uninstallSpy.count(), 1);
+    QCOMPARE(uninstallSpy.last().at(0).toString(), QString("chatCategoryDefinition"));
+    QCOMPARE(store->categoryDefinitionExists("chatCategoryDefinition"), false);
+}
+
 QTEST_APPLESS_MAIN(Ut_CategoryDefinitionStore)
@@ -32,12 +32,17 @@ private slots:
     void testCategoryDefinitionSettingsValues();
     void testCategoryDefinitionStoreMaxFileSizeHandling();
     void testCategoryDefinitionUninstalling();
+    void testCategoryDefinitionCaching();
+    void testCategoryDefinitionBundle();
+    void testCategoryDefinitionFilesChanged();
 
 private:
     CategoryDefinitionStore *store;
 
 signals:
     void directoryChanged(const QString &path);
+    void fileChanged(const QString &path);
+    void filesChanged(const QString &directory, const QStringList &added, const QStringList &modified, const QStringList &removed);
 };
 
 #endif
@@ -1,14 +1,18 @@
 include(../common.pri)
 TARGET = ut_categorydefinitionstore
-INCLUDEPATH += $$NOTIFICATIONSRCDIR
+INCLUDEPATH += $$NOTIFICATIONSRCDIR $$UTILITYSRCDIR
 
 # unit test and unit
 SOURCES += \
     ut_categorydefinitionstore.cpp \
     $$NOTIFICATIONSRCDIR/categorydefinitionstore.cpp \
+    $$NOTIFICATIONSRCDIR/categorydefinitionbundle.cpp \
+    $$UTILITYSRCDIR/directorywatcher.cpp \
     $$STUBSDIR/stubbase.cpp \
 
 # unit test and unit
 HEADERS += \
     ut_categorydefinitionstore.h \
-    $$NOTIFICATIONSRCDIR/categorydefinitionstore.h
+    $$NOTIFICATIONSRCDIR/categorydefinitionstore.h \
+    $$NOTIFICATIONSRCDIR/categorydefinitionbundle.h \
+    $$UTILITYSRCDIR/directorywatcher.h
@@ -0,0 +1,104 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QStandardPaths>
+
+#include "launcherfoldermodel.h"
+#include "launcheritem.h"
+#include "ut_launcherfoldermodel.h"
+
+static const int ITEM_COUNT = 1000;
+static const QString SCOPE("ut_launcherfoldermodel");
+
+class TestFolderModel : public LauncherFolderModel
+{
+public:
+    TestFolderModel()
+        : LauncherFolderModel(DeferInitialization)
+    {
+    }
+
+    using LauncherFolderModel::initialize;
+};
+
+void Ut_LauncherFolderModel::initTestCase()
+{
+    // Keep the saved menus and caches out of the user's configuration
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(desktopDir.isValid());
+    for (int i = 0; i < ITEM_COUNT; ++i) {
+        QFile file(QString("%1/app%2.desktop").arg(desktopDir.path()).arg(i));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QString("[Desktop Entry]\nType=Application\nName=App %1\nExec=app%1\n").arg(i).toUtf8());
+    }
+}
+
+void Ut_LauncherFolderModel::init()
+{
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/lipstick/" + SCOPE + ".menu");
+
+    folderModel = new TestFolderModel;
+    folderModel->setScope(SCOPE);
+    folderModel->setDirectories(QStringList() << desktopDir.path());
+    folderModel->initialize();
+}
+
+void Ut_LauncherFolderModel::cleanup()
+{
+    delete folderModel;
+}
+
+void Ut_LauncherFolderModel::testSaveAndLoad()
+{
+    QCOMPARE(folderModel->rowCount(), ITEM_COUNT);
+
+    QObject *first = folderModel->get(0);
+    QObject *last = folderModel->get(ITEM_COUNT - 1);
+    QVERIFY(folderModel->createFolder(0, "Folder") != 0);
+    folderModel->save();
+    folderModel->load();
+
+    QCOMPARE(folderModel->rowCount(), ITEM_COUNT);
+    LauncherFolderItem *folder = qobject_cast<LauncherFolderItem *>(folderModel->get(0));
+    QVERIFY(folder != 0);
+    QCOMPARE(folder->title(), QString("Folder"));
+    QCOMPARE(folder->rowCount(), 1);
+    QVERIFY(folder->get(0) == first);
+    QVERIFY(folderModel->get(ITEM_COUNT - 1) == last);
+}
+
+void Ut_LauncherFolderModel::benchmarkSave()
+{
+    QCOMPARE(folderModel->rowCount(), ITEM_COUNT);
+
+    // Measures the time the GUI thread spends saving, the menu is written by the writer thread
+    QBENCHMARK {
+        folderModel->save();
+    }
+}
+
+void Ut_LauncherFolderModel::benchmarkLoad()
+{
+    folderModel->save();
+
+    QBENCHMARK {
+        folderModel->load();
+    }
+
+    QCOMPARE(folderModel->rowCount(), ITEM_COUNT);
+}
+
+QTEST_MAIN(Ut_LauncherFolderModel)
@@ -0,0 +1,40 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef UT_LAUNCHERFOLDERMODEL_H
+#define UT_LAUNCHERFOLDERMODEL_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class TestFolderModel;
+
+class Ut_LauncherFolderModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testSaveAndLoad();
+    void benchmarkSave();
+    void benchmarkLoad();
+
+private:
+    QTemporaryDir desktopDir;
+    TestFolderModel *folderModel;
+};
+
+#endif
@@ -0,0 +1,35 @@
+include(../common.pri)
+TARGET = ut_launcherfoldermodel
+
+INCLUDEPATH += $$COMPONENTSSRCDIR
+INCLUDEPATH += $$UTILITYSRCDIR
+INCLUDEPATH += $$3RDPARTYSRCDIR
+
+PKGCONFIG += glib-2.0
+
+QT += dbus qml
+
+SOURCES += \
+    ut_launcherfoldermodel.cpp \
+    $$COMPONENTSSRCDIR/launcherfoldermodel.cpp \
+    $$COMPONENTSSRCDIR/launchermodel.cpp \
+    $$COMPONENTSSRCDIR/launchermonitor.cpp \
+    $$COMPONENTSSRCDIR/launcherpositionstore.cpp \
+    $$COMPONENTSSRCDIR/launcherentrycache.cpp \
+    $$COMPONENTSSRCDIR/launcheritem.cpp \
+    $$COMPONENTSSRCDIR/launcherdbus.cpp \
+    $$UTILITYSRCDIR/qobjectlistmodel.cpp \
+    $$UTILITYSRCDIR/directorywatcher.cpp \
+
+HEADERS += \
+    ut_launcherfoldermodel.h \
+    $$COMPONENTSSRCDIR/launcherfoldermodel.h \
+    $$COMPONENTSSRCDIR/launchermodel.h \
+    $$COMPONENTSSRCDIR/launchermonitor.h \
+    $$COMPONENTSSRCDIR/launcherpositionstore.h \
+    $$COMPONENTSSRCDIR/launcherentrycache.h \
+    $$COMPONENTSSRCDIR/launcheritem.h \
+    $$COMPONENTSSRCDIR/launcherdbus.h \
+    $$UTILITYSRCDIR/qobjectlistmodel.h \
+    $$UTILITYSRCDIR/directorywatcher.h \
+    $$3RDPARTYSRCDIR/synchronizelists.h \
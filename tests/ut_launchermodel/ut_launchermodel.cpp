@@ -17,6 +17,8 @@
 
 #include "launcheritem.h"
 #include "launchermodel.h"
+#include "launcherentrycache.h"
+#include "launcherpositionstore.h"
 #include "ut_launchermodel.h"
 #include "mdesktopentry.h"
 
@@ -30,9 +32,12 @@ public:
     QString m_fileName;
 };
 
+static QAtomicInt desktopEntriesParsed;
+
 MDesktopEntry::MDesktopEntry(const QString &fileName)
     : d_ptr(new MDesktopEntryPrivate(fileName))
 {
+    desktopEntriesParsed.ref();
 }
 
 MDesktopEntry::~MDesktopEntry()
@@ -58,10 +63,13 @@ MDesktopEntry::name() const
     return "";
 }
 
+// The Icon= values of the stubbed desktop files, by file name
+static QHash<QString, QString> desktopEntryIcons;
+
 QString
 MDesktopEntry::icon() const
 {
-    return "";
+    return desktopEntryIcons.value(d_ptr->m_fileName);
 }
 
 QString
@@ -132,6 +140,7 @@ void Ut_LauncherModel::init()
 void Ut_LauncherModel::cleanup()
 {
     delete launcherModel;
+    desktopEntryIcons.clear();
 }
 
 void Ut_LauncherModel::testUpdating()
@@ -202,4 +211,287 @@ void Ut_LauncherModel::testUpdatingFileAppears()
     QVERIFY(launcherModel->temporaryItemToReplace() == NULL);
 }
 
+void Ut_LauncherModel::testItemLookups()
+{
+    LauncherItem *first = new LauncherItem("/usr/share/applications/lipstick_ut_first.desktop", launcherModel);
+    LauncherItem *second = new LauncherItem("/home/nemo/.local/share/applications/lipstick_ut_first.desktop", launcherModel);
+    launcherModel->addItem(first);
+    launcherModel->addItem(second);
+
+    // Items are found by their full path
+    QCOMPARE(launcherModel->itemInModel("/usr/share/applications/lipstick_ut_first.desktop"), first);
+    QCOMPARE(launcherModel->itemInModel("/home/nemo/.local/share/applications/lipstick_ut_first.desktop"), second);
+
+    // Items sharing a file name are found in model order
+    QCOMPARE(launcherModel->itemInModel("lipstick_ut_first.desktop"), first);
+    QCOMPARE(launcherModel->indexInModel("lipstick_ut_first.desktop"), launcherModel->indexOf(first));
+
+    // The lookups follow the changes of the items
+    first->setFilePath("/usr/share/applications/lipstick_ut_renamed.desktop");
+    QVERIFY(launcherModel->itemInModel("/usr/share/applications/lipstick_ut_first.desktop") == NULL);
+    QCOMPARE(launcherModel->itemInModel("lipstick_ut_first.desktop"), second);
+    QCOMPARE(launcherModel->itemInModel("lipstick_ut_renamed.desktop"), first);
+    second->setPackageName("secondpackage");
+    QCOMPARE(launcherModel->packageInModel("secondpackage"), second);
+
+    // Destroyed items are not found any more
+    delete second;
+    QVERIFY(launcherModel->itemInModel("lipstick_ut_first.desktop") == NULL);
+    QVERIFY(launcherModel->packageInModel("secondpackage") == NULL);
+}
+
+void Ut_LauncherModel::testIconLookups()
+{
+    const QString byId("/usr/share/applications/lipstick_ut_iconid.desktop");
+    const QString byPath("/usr/share/applications/lipstick_ut_iconpath.desktop");
+    const QString iconFile("/usr/share/icons/hicolor/86x86/apps/lipstick_ut_icon.png");
+    const QString otherIconFile("/usr/share/icons/hicolor/86x86/apps/lipstick_ut_other.png");
+    const QString absoluteIconFile("/opt/lipstick_ut/lipstick_ut_absolute.png");
+    desktopEntryIcons.insert(byId, "lipstick_ut_icon");
+    desktopEntryIcons.insert(byPath, absoluteIconFile);
+
+    launcherModel->onFilesUpdated(QStringList() << byId << byPath, QStringList(), QStringList());
+    LauncherItem *idItem = launcherModel->itemInModel(byId);
+    LauncherItem *pathItem = launcherModel->itemInModel(byPath);
+    QVERIFY(idItem != 0);
+    QVERIFY(pathItem != 0);
+    QVERIFY(idItem->iconFilename().isEmpty());
+    QVERIFY(pathItem->iconFilename().isEmpty());
+
+    // Icons are matched by their id and by the absolute path in the desktop file
+    launcherModel->onFilesUpdated(QStringList() << iconFile, QStringList(), QStringList());
+    QCOMPARE(idItem->iconFilename(), iconFile);
+    QVERIFY(pathItem->iconFilename().isEmpty());
+    launcherModel->onFilesUpdated(QStringList() << absoluteIconFile, QStringList(), QStringList());
+    QCOMPARE(pathItem->iconFilename(), absoluteIconFile);
+    QCOMPARE(idItem->iconFilename(), iconFile);
+
+    // Removed icons are cleared
+    launcherModel->onFilesUpdated(QStringList(), QStringList(), QStringList() << iconFile);
+    QVERIFY(idItem->iconFilename().isEmpty());
+    QCOMPARE(pathItem->iconFilename(), absoluteIconFile);
+
+    // Items are matched by the current Icon= of their desktop file
+    desktopEntryIcons.insert(byId, "lipstick_ut_other");
+    launcherModel->onFilesUpdated(QStringList(), QStringList() << byId, QStringList());
+    launcherModel->onFilesUpdated(QStringList() << iconFile, QStringList(), QStringList());
+    QVERIFY(idItem->iconFilename().isEmpty());
+    launcherModel->onFilesUpdated(QStringList() << otherIconFile, QStringList(), QStringList());
+    QCOMPARE(idItem->iconFilename(), otherIconFile);
+    launcherModel->onFilesUpdated(QStringList(), QStringList(), QStringList() << otherIconFile);
+    QVERIFY(idItem->iconFilename().isEmpty());
+
+    // New items get an icon that is already installed
+    const QString newItemPath("/usr/share/applications/lipstick_ut_iconnew.desktop");
+    desktopEntryIcons.insert(newItemPath, "lipstick_ut_icon");
+    launcherModel->onFilesUpdated(QStringList() << newItemPath, QStringList(), QStringList());
+    LauncherItem *newItem = launcherModel->itemInModel(newItemPath);
+    QVERIFY(newItem != 0);
+    QCOMPARE(newItem->iconFilename(), iconFile);
+}
+
+void Ut_LauncherModel::testReorderItems()
+{
+    for (int i = 0; i < 5; ++i) {
+        launcherModel->addItem(new LauncherItem(QString("/usr/share/applications/lipstick_ut_reorder%1.desktop").arg(i), launcherModel));
+    }
+
+    // Moving the last item to the front takes a single move
+    QList<LauncherItem *> expected = *launcherModel->getList<LauncherItem>();
+    expected.prepend(expected.takeLast());
+    for (int i = 0; i < expected.count(); ++i) {
+        launcherModel->_launcherPositions.insert(expected.at(i)->filePath(), i);
+    }
+
+    QSignalSpy moveSpy(launcherModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    launcherModel->reorderItems();
+    QCOMPARE(moveSpy.count(), 1);
+    QCOMPARE(*launcherModel->getList<LauncherItem>(), expected);
+
+    // Items already in order are not moved
+    launcherModel->reorderItems();
+    QCOMPARE(moveSpy.count(), 1);
+
+    // Swapping the first and the last item takes two moves
+    expected.swap(0, expected.count() - 1);
+    for (int i = 0; i < expected.count(); ++i) {
+        launcherModel->_launcherPositions.insert(expected.at(i)->filePath(), i);
+    }
+    launcherModel->reorderItems();
+    QCOMPARE(moveSpy.count(), 3);
+    QCOMPARE(*launcherModel->getList<LauncherItem>(), expected);
+}
+
+void Ut_LauncherModel::testFilesUpdated()
+{
+    QStringList added;
+    for (int i = 0; i < 3; ++i) {
+        added.append(QString("/usr/share/applications/lipstick_ut_update%1.desktop").arg(i));
+    }
+
+    // The new items are inserted in one go, without moving them afterwards
+    const int count = launcherModel->rowCount();
+    QSignalSpy insertSpy(launcherModel, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy moveSpy(launcherModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy addSpy(launcherModel, SIGNAL(itemAdded(QObject*)));
+    launcherModel->onFilesUpdated(added, QStringList(), QStringList());
+    QCOMPARE(launcherModel->rowCount(), count + 3);
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(moveSpy.count(), 0);
+    QCOMPARE(addSpy.count(), 3);
+    foreach (const QString &path, added) {
+        QVERIFY(launcherModel->itemInModel(path) != 0);
+    }
+
+    // Removed items are removed in one go as well
+    QSignalSpy removeSpy(launcherModel, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    launcherModel->onFilesUpdated(QStringList(), QStringList(), added);
+    QCOMPARE(launcherModel->rowCount(), count);
+    QCOMPARE(removeSpy.count(), 1);
+    QVERIFY(launcherModel->itemInModel(added.first()) == 0);
+
+    // Items added by a file update are removed from the model when they are destroyed
+    launcherModel->onFilesUpdated(added, QStringList(), QStringList());
+    QCOMPARE(launcherModel->rowCount(), count + 3);
+    delete launcherModel->itemInModel(added.first());
+    QCOMPARE(launcherModel->rowCount(), count + 2);
+    QVERIFY(launcherModel->itemInModel(added.first()) == 0);
+    QVERIFY(launcherModel->itemInModel(added.last()) != 0);
+}
+
+void Ut_LauncherModel::testPositionStore()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/launcherpositions.dat";
+    const QStringList order = QStringList() << "/usr/share/applications/a.desktop" << "/usr/share/applications/b.desktop";
+
+    {
+        LauncherPositionStore store(path);
+        QVERIFY(!store.hasPositions());
+        QCOMPARE(store.position("/usr/share/applications/a.desktop"), -1);
+
+        // An unchanged order is not written again
+        QVERIFY(store.save(order));
+        QVERIFY(!store.save(order));
+        QCOMPARE(store.position("/usr/share/applications/b.desktop"), 1);
+    }
+
+    LauncherPositionStore store(path);
+    QVERIFY(store.hasPositions());
+    QCOMPARE(store.position("/usr/share/applications/a.desktop"), 0);
+    QCOMPARE(store.position("/usr/share/applications/b.desktop"), 1);
+    QVERIFY(!store.reload());
+
+    // Orders written by others are read when reloading
+    {
+        LauncherPositionStore other(path);
+        QVERIFY(other.save(QStringList() << "/usr/share/applications/b.desktop"));
+    }
+    QVERIFY(store.reload());
+    QCOMPARE(store.position("/usr/share/applications/a.desktop"), -1);
+    QCOMPARE(store.position("/usr/share/applications/b.desktop"), 0);
+
+    // Failed writes don't keep the order, and it is written again by the next save
+    QFile blocker(dir.path() + "/blocker");
+    QVERIFY(blocker.open(QIODevice::WriteOnly));
+    blocker.close();
+    LauncherPositionStore failing(blocker.fileName() + "/launcherpositions.dat");
+    QVERIFY(!failing.write(order));
+    QVERIFY(!failing.hasPositions());
+    QVERIFY(failing.save(order));
+    failing.waitForWrites();
+    QVERIFY(failing.save(order));
+    failing.waitForWrites();
+    QVERIFY(blocker.remove());
+    QVERIFY(failing.save(order));
+    failing.waitForWrites();
+    QVERIFY(!failing.save(order));
+    QVERIFY(QFile::exists(failing.path()));
+}
+
+void Ut_LauncherModel::testEntryCache()
+{
+    QTemporaryDir dir;
+    const QString cachePath = dir.path() + "/launcherentries.dat";
+    const QString desktopPath = dir.path() + "/a.desktop";
+    QFile desktopFile(desktopPath);
+    QVERIFY(desktopFile.open(QIODevice::WriteOnly));
+    desktopFile.write("[Desktop Entry]\nType=Application\n");
+    desktopFile.close();
+
+    desktopEntriesParsed.store(0);
+    {
+        LauncherEntryCache cache(cachePath);
+        QVERIFY(!cache.save());
+
+        QSharedPointer<const LauncherEntry> entry = cache.entry(desktopPath);
+        QCOMPARE(desktopEntriesParsed.load(), 1);
+        QCOMPARE(entry->type, QString("Application"));
+        QVERIFY(cache.entry(desktopPath) == entry);
+        QCOMPARE(desktopEntriesParsed.load(), 1);
+
+        QVERIFY(cache.save());
+        QVERIFY(!cache.save());
+    }
+
+    // Entries of unchanged files are read from the cache
+    {
+        LauncherEntryCache cache(cachePath);
+        QSharedPointer<const LauncherEntry> entry = cache.entry(desktopPath);
+        QCOMPARE(desktopEntriesParsed.load(), 1);
+        QCOMPARE(entry->type, QString("Application"));
+        QVERIFY(entry->isValid);
+    }
+
+    // Changed files are parsed again
+    QVERIFY(desktopFile.open(QIODevice::Append));
+    desktopFile.write("Name=A\n");
+    desktopFile.close();
+    {
+        LauncherEntryCache cache(cachePath);
+        cache.entry(desktopPath);
+        QCOMPARE(desktopEntriesParsed.load(), 2);
+    }
+
+    // Corrupted caches claiming huge amounts of data are ignored
+    QFile cacheFile(cachePath);
+    QVERIFY(cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(0x4c454e54) << quint32(1) << QLocale().name() << quint32(0xffffffff)
+           << desktopPath << qint64(0) << qint64(0)
+           << QString() << QString() << QString() << QString("Application") << QString()
+           << quint32(0xffffffff);
+    cacheFile.close();
+    {
+        LauncherEntryCache cache(cachePath);
+        cache.entry(desktopPath);
+        QCOMPARE(desktopEntriesParsed.load(), 3);
+    }
+}
+
+void Ut_LauncherModel::testEntryCachePrefetch()
+{
+    QTemporaryDir dir;
+    QStringList desktopPaths;
+    for (int i = 0; i < 20; ++i) {
+        desktopPaths.append(QString("%1/app%2.desktop").arg(dir.path()).arg(i));
+        QFile desktopFile(desktopPaths.last());
+        QVERIFY(desktopFile.open(QIODevice::WriteOnly));
+        desktopFile.write("[Desktop Entry]\nType=Application\n");
+    }
+
+    LauncherEntryCache cache(dir.path() + "/launcherentries.dat");
+    desktopEntriesParsed.store(0);
+    cache.prefetch(desktopPaths);
+    QCOMPARE(desktopEntriesParsed.load(), 20);
+
+    // The prefetched entries are used and the files are not parsed again
+    foreach (const QString &desktopPath, desktopPaths) {
+        QCOMPARE(cache.entry(desktopPath)->type, QString("Application"));
+    }
+    cache.prefetch(desktopPaths);
+    QCOMPARE(desktopEntriesParsed.load(), 20);
+}
+
 QTEST_MAIN(Ut_LauncherModel)
@@ -29,6 +29,13 @@ private slots:
     void cleanup();
     void testUpdating();
     void testUpdatingFileAppears();
+    void testItemLookups();
+    void testIconLookups();
+    void testReorderItems();
+    void testFilesUpdated();
+    void testPositionStore();
+    void testEntryCache();
+    void testEntryCachePrefetch();
 
 private:
     LauncherModel *launcherModel;
@@ -13,18 +13,24 @@ SOURCES += \
     ut_launchermodel.cpp \
     $$COMPONENTSSRCDIR/launchermodel.cpp \
     $$COMPONENTSSRCDIR/launchermonitor.cpp \
+    $$COMPONENTSSRCDIR/launcherpositionstore.cpp \
+    $$COMPONENTSSRCDIR/launcherentrycache.cpp \
     $$COMPONENTSSRCDIR/launcheritem.cpp \
     $$COMPONENTSSRCDIR/launcherdbus.cpp \
     $$STUBSDIR/stubbase.cpp \
     $$UTILITYSRCDIR/qobjectlistmodel.cpp \
+    $$UTILITYSRCDIR/directorywatcher.cpp \
 
 HEADERS += \
     ut_launchermodel.h \
     $$COMPONENTSSRCDIR/launchermodel.h \
     $$COMPONENTSSRCDIR/launchermonitor.h \
+    $$COMPONENTSSRCDIR/launcherpositionstore.h \
+    $$COMPONENTSSRCDIR/launcherentrycache.h \
     $$COMPONENTSSRCDIR/launcheritem.h \
     $$COMPONENTSSRCDIR/launcherdbus.h \
     $$UTILITYSRCDIR/qobjectlistmodel.h \
+    $$UTILITYSRCDIR/directorywatcher.h \
     $$3RDPARTYSRCDIR/synchronizelists.h \
     /usr/include/mlite5/mdesktopentry.h \
 
@@ -0,0 +1,130 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include "launchermonitor.h"
+#include "ut_launchermonitor.h"
+
+static void createFile(const QString &path)
+{
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+}
+
+void Ut_LauncherMonitor::testFilesChanged()
+{
+    QTemporaryDir desktopDir;
+    QTemporaryDir iconDir;
+    LauncherMonitor monitor(desktopDir.path(), iconDir.path());
+    QSignalSpy spy(&monitor, SIGNAL(filesUpdated(QStringList,QStringList,QStringList)));
+
+    const QString a = desktopDir.path() + "/a.desktop";
+    const QString b = desktopDir.path() + "/b.desktop";
+    const QString c = desktopDir.path() + "/c.desktop";
+
+    // Added files are reported in the order they were added, modifications of them are not reported
+    monitor.onFilesChanged(desktopDir.path(), QStringList() << b << a, QStringList(), QStringList());
+    monitor.onFilesChanged(desktopDir.path(), QStringList(), QStringList() << a, QStringList());
+    monitor.onHoldbackTimerTimeout();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.last().at(0).toStringList(), QStringList() << b << a);
+    QCOMPARE(spy.last().at(1).toStringList(), QStringList());
+    QCOMPARE(spy.last().at(2).toStringList(), QStringList());
+
+    // A known file reported as added has been replaced, a file added and removed again is not reported
+    monitor.onFilesChanged(desktopDir.path(), QStringList() << a << c, QStringList(), QStringList());
+    monitor.onFilesChanged(desktopDir.path(), QStringList(), QStringList(), QStringList() << c << b);
+    monitor.onHoldbackTimerTimeout();
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.last().at(0).toStringList(), QStringList());
+    QCOMPARE(spy.last().at(1).toStringList(), QStringList() << a);
+    QCOMPARE(spy.last().at(2).toStringList(), QStringList() << b);
+
+    // A file removed and added again before the update is sent is reported as modified
+    monitor.onFilesChanged(desktopDir.path(), QStringList(), QStringList(), QStringList() << a);
+    monitor.onFilesChanged(desktopDir.path(), QStringList() << a, QStringList(), QStringList());
+    monitor.onHoldbackTimerTimeout();
+    QCOMPARE(spy.count(), 3);
+    QCOMPARE(spy.last().at(0).toStringList(), QStringList());
+    QCOMPARE(spy.last().at(1).toStringList(), QStringList() << a);
+    QCOMPARE(spy.last().at(2).toStringList(), QStringList());
+
+    // Changes in other directories and hidden files are ignored
+    monitor.onFilesChanged("/nonexistent", QStringList() << "/nonexistent/a.desktop", QStringList(), QStringList());
+    monitor.onFilesChanged(desktopDir.path(), QStringList() << desktopDir.path() + "/.hidden", QStringList(), QStringList());
+    monitor.onHoldbackTimerTimeout();
+    QCOMPARE(spy.count(), 3);
+}
+
+void Ut_LauncherMonitor::testDirectoryChanged()
+{
+    QTemporaryDir desktopDir;
+    QTemporaryDir iconDir;
+    const QString a = desktopDir.path() + "/a.desktop";
+    const QString b = desktopDir.path() + "/b.desktop";
+    const QString c = desktopDir.path() + "/c.desktop";
+    createFile(b);
+    createFile(a);
+
+    LauncherMonitor monitor(desktopDir.path(), iconDir.path());
+    QSignalSpy spy(&monitor, SIGNAL(filesUpdated(QStringList,QStringList,QStringList)));
+    monitor.start();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.last().at(0).toStringList(), QStringList() << a << b);
+
+    QFile::remove(a);
+    createFile(c);
+    monitor.onDirectoryChanged(desktopDir.path());
+    monitor.onHoldbackTimerTimeout();
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.last().at(0).toStringList(), QStringList() << c);
+    QCOMPARE(spy.last().at(1).toStringList(), QStringList());
+    QCOMPARE(spy.last().at(2).toStringList(), QStringList() << a);
+}
+
+void Ut_LauncherMonitor::benchmarkDirectoryChurn()
+{
+    QTemporaryDir desktopDir;
+    QTemporaryDir iconDir;
+    QStringList paths;
+    for (int i = 0; i < 2000; ++i) {
+        paths.append(QString("%1/app%2.desktop").arg(desktopDir.path()).arg(i));
+        createFile(paths.last());
+    }
+    const QStringList firstHalf = paths.mid(0, paths.count() / 2);
+    const QStringList secondHalf = paths.mid(paths.count() / 2);
+
+    LauncherMonitor monitor(desktopDir.path(), iconDir.path());
+    QSignalSpy spy(&monitor, SIGNAL(filesUpdated(QStringList,QStringList,QStringList)));
+    monitor.onHoldbackTimerTimeout();
+
+    QBENCHMARK {
+        // List the directory as if it had just been installed, then update
+        // half of the files and reinstall the other half
+        monitor.m_knownFiles[desktopDir.path()].clear();
+        monitor.onDirectoryChanged(desktopDir.path());
+        monitor.onHoldbackTimerTimeout();
+        monitor.onFilesChanged(desktopDir.path(), QStringList(), firstHalf, secondHalf);
+        monitor.onFilesChanged(desktopDir.path(), secondHalf, QStringList(), QStringList());
+        monitor.onHoldbackTimerTimeout();
+    }
+
+    QCOMPARE(spy.last().at(0).toStringList(), QStringList());
+    QCOMPARE(spy.last().at(1).toStringList(), paths);
+    QCOMPARE(spy.last().at(2).toStringList(), QStringList());
+}
+
+QTEST_MAIN(Ut_LauncherMonitor)
@@ -0,0 +1,30 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#ifndef UT_LAUNCHERMONITOR_H
+#define UT_LAUNCHERMONITOR_H
+
+#include <QObject>
+
+class Ut_LauncherMonitor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testFilesChanged();
+    void testDirectoryChanged();
+    void benchmarkDirectoryChurn();
+};
+
+#endif
@@ -0,0 +1,20 @@
+include(../common.pri)
+TARGET = ut_launchermonitor
+
+INCLUDEPATH += $$COMPONENTSSRCDIR
+INCLUDEPATH += $$UTILITYSRCDIR
+INCLUDEPATH += $$3RDPARTYSRCDIR
+
+QMAKE_CXXFLAGS += `pkg-config --cflags-only-I mlite5`
+
+QT += dbus
+
+SOURCES += \
+    ut_launchermonitor.cpp \
+    $$COMPONENTSSRCDIR/launchermonitor.cpp \
+    $$UTILITYSRCDIR/directorywatcher.cpp \
+
+HEADERS += \
+    ut_launchermonitor.h \
+    $$COMPONENTSSRCDIR/launchermonitor.h \
+    $$UTILITYSRCDIR/directorywatcher.h \
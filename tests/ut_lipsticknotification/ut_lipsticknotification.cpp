@@ -174,6 +174,38 @@ void Ut_Notification::testIcon()
     QCOMPARE(notification2.icon(), icon);
 }
 
+void Ut_Notification::testHintValues()
+{
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_CATEGORY, "category");
+    hints.insert(NotificationManager::HINT_USER_REMOVABLE, false);
+    hints.insert(NotificationManager::HINT_RESTORED, true);
+    hints.insert(QString(NotificationManager::HINT_REMOTE_ACTION_PREFIX) + "default", "a.b.c /d e.f.g h");
+    hints.insert(QString(NotificationManager::HINT_REMOTE_ACTION_ICON_PREFIX) + "default", "icon");
+    hints.insert(QString(NotificationManager::HINT_PREVIEW_BODY).toUpper(), "previewBody");
+    hints.insert("x-nemo.testing.custom-hint-value", 1);
+    LipstickNotification notification(QString(), 0, QString(), QString(), QString(), QStringList(), hints, 0);
+
+    // Well-known hints are represented by properties, but only when the key matches exactly
+    QCOMPARE(notification.category(), QString("category"));
+    QCOMPARE(notification.isUserRemovable(), false);
+    QCOMPARE(notification.restored(), true);
+    QCOMPARE(notification.hidden(), false);
+    QCOMPARE(notification.previewBody(), QString());
+
+    // Hints represented by properties are filtered from the hint values regardless of case
+    QCOMPARE(notification.hintValues().count(), 2);
+    QCOMPARE(notification.hintValues().value("x-nemo.testing.custom-hint-value"), QVariant(1));
+    QCOMPARE(notification.hintValues().value(NotificationManager::HINT_RESTORED), QVariant(true));
+
+    // Resetting the hints resets the properties
+    notification.setHints(QVariantHash());
+    QCOMPARE(notification.category(), QString());
+    QCOMPARE(notification.isUserRemovable(), true);
+    QCOMPARE(notification.restored(), false);
+    QCOMPARE(notification.hintValues().count(), 0);
+}
+
 void Ut_Notification::testSignals()
 {
     QVariantHash hints;
@@ -186,6 +218,8 @@ void Ut_Notification::testSignals()
     QSignalSpy previewSummarySpy(&notification, SIGNAL(previewSummaryChanged()));
     QSignalSpy previewBodySpy(&notification, SIGNAL(previewBodyChanged()));
     QSignalSpy urgencySpy(&notification, SIGNAL(urgencyChanged()));
+    QSignalSpy userRemovableSpy(&notification, SIGNAL(userRemovableChanged()));
+    QSignalSpy hintsSpy(&notification, SIGNAL(hintsChanged()));
 
     notification.setSummary("summary");
     QCOMPARE(summarySpy.count(), 1);
@@ -225,6 +259,23 @@ void Ut_Notification::testSignals()
     notification.setHints(hints);
     QCOMPARE(previewBodySpy.count(), 1);
     QCOMPARE(urgencySpy.count(), 1);
+
+    hints.insert(NotificationManager::HINT_USER_REMOVABLE, false);
+    notification.setHints(hints);
+    QCOMPARE(urgencySpy.count(), 1);
+    QCOMPARE(userRemovableSpy.count(), 1);
+    QCOMPARE(hintsSpy.count(), 7);
+
+    // Changing other hints should only emit hintsChanged()
+    hints.insert("x-nemo.testing.custom-hint-value", 1);
+    notification.setHints(hints);
+    QCOMPARE(hintsSpy.count(), 8);
+    QCOMPARE(iconSpy.count() + timestampSpy.count() + previewIconSpy.count() + previewSummarySpy.count() + previewBodySpy.count() + urgencySpy.count() + userRemovableSpy.count(), 7);
+
+    // Setting the same hints again should emit nothing
+    notification.setHints(hints);
+    QCOMPARE(hintsSpy.count(), 8);
+    QCOMPARE(iconSpy.count() + timestampSpy.count() + previewIconSpy.count() + previewSummarySpy.count() + previewBodySpy.count() + urgencySpy.count() + userRemovableSpy.count(), 7);
 }
 
 void Ut_Notification::testSerialization()
@@ -25,6 +25,7 @@ private slots:
     void testGettersAndSetters();
     void testIcon_data();
     void testIcon();
+    void testHintValues();
     void testSignals();
     void testSerialization();
 };
@@ -18,6 +18,11 @@
 #include "notificationlistmodel.h"
 #include "notificationmanager_stub.h"
 
+// When set, single shot timers are kept until runDeferredSingleShots() is called,
+// as if the event loop had not run yet
+static bool singleShotsDeferred = false;
+static QList<QPair<QObject *, QByteArray> > deferredSingleShots;
+
 void QTimer::singleShot(int, const QObject *receiver, const char *member)
 {
     // The "member" string is of form "1member()", so remove the trailing 1 and the ()
@@ -25,9 +30,22 @@ void QTimer::singleShot(int, const QObject *receiver, const char *member)
     char modifiedMember[memberLength + 1];
     strncpy(modifiedMember, member + 1, memberLength);
     modifiedMember[memberLength] = 0;
+    if (singleShotsDeferred) {
+        deferredSingleShots.append(qMakePair(const_cast<QObject *>(receiver), QByteArray(modifiedMember)));
+        return;
+    }
     QMetaObject::invokeMethod(const_cast<QObject *>(receiver), modifiedMember, Qt::DirectConnection);
 }
 
+static void runDeferredSingleShots()
+{
+    QList<QPair<QObject *, QByteArray> > singleShots;
+    singleShots.swap(deferredSingleShots);
+    for (int i = 0; i < singleShots.count(); ++i) {
+        QMetaObject::invokeMethod(singleShots.at(i).first, singleShots.at(i).second.constData(), Qt::DirectConnection);
+    }
+}
+
 void Ut_NotificationListModel::init()
 {
 }
@@ -35,6 +53,8 @@ void Ut_NotificationListModel::init()
 void Ut_NotificationListModel::cleanup()
 {
     gNotificationManagerStub->stubReset();
+    singleShotsDeferred = false;
+    deferredSingleShots.clear();
 }
 
 void Ut_NotificationListModel::testSignalConnections()
@@ -224,4 +244,158 @@ void Ut_NotificationListModel::testRemoteActions()
     QCOMPARE(remoteAction["icon"].toString(), QString());
 }
 
+void Ut_NotificationListModel::testBatchedNotificationUpdates()
+{
+    NotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    const QDateTime baseTime(QDate(2013, 1, 1), QTime(12, 0));
+    for (uint id = 1; id <= 4; ++id) {
+        QVariantHash hints;
+        hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs(id));
+        LipstickNotification *notification = new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), hints, 1);
+        notifications.append(notification);
+        gNotificationManagerStub->stubSetReturnValue("notification", notification);
+        model.updateNotification(id);
+    }
+    QCOMPARE(model.itemCount(), 4);
+    QCOMPARE(model.get(0), notifications.at(3));
+
+    QSignalSpy insertedSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy removedSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy dataChangedSpy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+
+    // Modifications reported separately before the event loop runs are applied once, moving the notification to the top
+    singleShotsDeferred = true;
+    QVariantHash hints(notifications.at(0)->hints());
+    hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs(10));
+    notifications.at(0)->setHints(hints);
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(0));
+    model.updateNotifications(QList<uint>() << 1);
+    hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs(11));
+    notifications.at(0)->setHints(hints);
+    model.updateNotifications(QList<uint>() << 1 << 1);
+    QCOMPARE(model.get(3), notifications.at(0));
+    QCOMPARE(insertedSpy.count(), 0);
+    QCOMPARE(deferredSingleShots.count(), 1);
+    const int lookups = gNotificationManagerStub->stubCallCount("notification");
+    runDeferredSingleShots();
+    singleShotsDeferred = false;
+    QCOMPARE(gNotificationManagerStub->stubCallCount("notification"), lookups + 1);
+    QCOMPARE(model.itemCount(), 4);
+    QCOMPARE(model.get(0), notifications.at(0));
+    QCOMPARE(model.get(1), notifications.at(3));
+    QCOMPARE(model.get(2), notifications.at(2));
+    QCOMPARE(model.get(3), notifications.at(1));
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(removedSpy.count(), 1);
+
+    // A modification which does not affect the order is reported as a data change
+    insertedSpy.clear();
+    removedSpy.clear();
+    dataChangedSpy.clear();
+    notifications.at(2)->setAppName("differentAppName");
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(2));
+    model.updateNotifications(QList<uint>() << 3);
+    QCOMPARE(model.get(2), notifications.at(2));
+    QCOMPARE(insertedSpy.count(), 0);
+    QCOMPARE(removedSpy.count(), 0);
+    QCOMPARE(dataChangedSpy.count(), 1);
+    QCOMPARE(qvariant_cast<QModelIndex>(dataChangedSpy.at(0).at(0)).row(), 2);
+
+    // Hidden notifications are removed
+    hints = notifications.at(3)->hints();
+    hints.insert(NotificationManager::HINT_HIDDEN, true);
+    notifications.at(3)->setHints(hints);
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(3));
+    model.updateNotifications(QList<uint>() << 4);
+    QCOMPARE(model.itemCount(), 3);
+    QCOMPARE(model.indexOf(notifications.at(3)), -1);
+
+    // The model keeps its order for the following single updates
+    hints = notifications.at(1)->hints();
+    hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs(20));
+    notifications.at(1)->setHints(hints);
+    gNotificationManagerStub->stubSetReturnValue("notification", notifications.at(1));
+    model.updateNotification(2);
+    QCOMPARE(model.itemCount(), 3);
+    QCOMPARE(model.get(0), notifications.at(1));
+    QCOMPARE(model.get(1), notifications.at(0));
+    QCOMPARE(model.get(2), notifications.at(2));
+
+    qDeleteAll(notifications);
+}
+
+void Ut_NotificationListModel::testLargeModelStaysOrdered()
+{
+    NotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    const QDateTime baseTime(QDate(2013, 1, 1), QTime(12, 0));
+    for (uint id = 1; id <= 100; ++id) {
+        QVariantHash hints;
+        hints.insert(NotificationManager::HINT_PRIORITY, int(id % 3));
+        hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs((id * 37) % 100));
+        LipstickNotification *notification = new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), hints, 1);
+        notifications.append(notification);
+        gNotificationManagerStub->stubSetReturnValue("notification", notification);
+        model.updateNotification(id);
+    }
+    QCOMPARE(model.itemCount(), 100);
+
+    // Move every third notification and hide every tenth one
+    for (int i = 0; i < notifications.count(); ++i) {
+        LipstickNotification *notification = notifications.at(i);
+        QVariantHash hints(notification->hints());
+        if (i % 10 == 0) {
+            hints.insert(NotificationManager::HINT_HIDDEN, true);
+        } else if (i % 3 == 0) {
+            hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs((i * 53) % 100 + 50));
+        } else {
+            continue;
+        }
+        notification->setHints(hints);
+        gNotificationManagerStub->stubSetReturnValue("notification", notification);
+        model.updateNotification(notification->replacesId());
+    }
+    QCOMPARE(model.itemCount(), 90);
+
+    // Destroyed notifications are removed from the model
+    delete notifications.takeLast();
+    QCOMPARE(model.itemCount(), 89);
+
+    for (int row = 1; row < model.itemCount(); ++row) {
+        QVERIFY(*static_cast<LipstickNotification *>(model.get(row - 1)) < *static_cast<LipstickNotification *>(model.get(row)));
+    }
+
+    qDeleteAll(notifications);
+}
+
+void Ut_NotificationListModel::benchmarkUpdatingNotification()
+{
+    NotificationListModel model;
+    QList<LipstickNotification *> notifications;
+    const QDateTime baseTime(QDate(2013, 1, 1), QTime(12, 0));
+    for (uint id = 1; id <= 500; ++id) {
+        QVariantHash hints;
+        hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs(id));
+        LipstickNotification *notification = new LipstickNotification("appName", id, "appIcon", "summary", "body", QStringList(), hints, 1);
+        notifications.append(notification);
+        gNotificationManagerStub->stubSetReturnValue("notification", notification);
+        model.updateNotification(id);
+    }
+
+    // Keep moving the oldest notification to the top
+    int seconds = 500;
+    QBENCHMARK {
+        LipstickNotification *notification = static_cast<LipstickNotification *>(model.get(model.itemCount() - 1));
+        QVariantHash hints(notification->hints());
+        hints.insert(NotificationManager::HINT_TIMESTAMP, baseTime.addSecs(++seconds));
+        notification->setHints(hints);
+        gNotificationManagerStub->stubSetReturnValue("notification", notification);
+        model.updateNotification(notification->replacesId());
+    }
+    QCOMPARE(model.itemCount(), 500);
+
+    qDeleteAll(notifications);
+}
+
 QTEST_MAIN(Ut_NotificationListModel)
@@ -35,6 +35,9 @@ private slots:
     void testNotificationOrdering();
     void testNotificationUpdate();
     void testRemoteActions();
+    void testBatchedNotificationUpdates();
+    void testLargeModelStaysOrdered();
+    void benchmarkUpdatingNotification();
 };
 
 #endif
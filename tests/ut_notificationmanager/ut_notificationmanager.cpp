@@ -28,6 +28,25 @@
 
 const static uint DISK_SPACE_NEEDED = 1024;
 
+// The hints are stored in the notifications table in the same format as the notification manager uses
+QByteArray serializedHints(const QVariantHash &hints)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << hints;
+    return data;
+}
+
+QVariantHash deserializedHints(const QVariant &data)
+{
+    QVariantHash hints;
+    QDataStream stream(data.toByteArray());
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream >> hints;
+    return hints;
+}
+
 unsigned long diskSpaceAvailableKb;
 bool diskSpaceChecked;
 int statfs (const char *, struct statfs *st)
@@ -101,13 +120,14 @@ bool QSqlDatabase::commit()
 
 // QSqlQuery stubs
 QStringList qSqlQueryExecQuery = QStringList();
-int qSqlQueryIndex = -1;
+// The executed query and the current row index of each query object
+QHash<const QSqlQuery *, QPair<QString, int> > qSqlQueryState;
 QSqlQuery::QSqlQuery(const QString& query, QSqlDatabase)
 {
     if (!query.isEmpty()) {
         qSqlQueryExecQuery << query;
+        qSqlQueryState.insert(this, qMakePair(query, -1));
     }
-    qSqlQueryIndex = -1;
 }
 
 QSqlQuery::~QSqlQuery()
@@ -117,12 +137,21 @@ QSqlQuery::~QSqlQuery()
 bool QSqlQuery::exec(const QString& query)
 {
     qSqlQueryExecQuery << query;
-    qSqlQueryIndex = -1;
+    qSqlQueryState.insert(this, qMakePair(query, -1));
     return true;
 }
 
+QHash<const QSqlQuery *, QString> qSqlQueryPreparedStatement;
+QStringList qSqlQueryExecPrepared = QStringList();
 bool QSqlQuery::exec()
 {
+    qSqlQueryExecPrepared << qSqlQueryPreparedStatement.value(this);
+    return true;
+}
+
+bool QSqlQuery::execBatch(BatchExecutionMode)
+{
+    qSqlQueryExecPrepared << qSqlQueryPreparedStatement.value(this);
     return true;
 }
 
@@ -135,6 +164,7 @@ QStringList qSqlQueryPrepare = QStringList();
 bool QSqlQuery::prepare(const QString& query)
 {
     qSqlQueryPrepare << query;
+    qSqlQueryPreparedStatement.insert(this, query);
     return true;
 }
 
@@ -148,21 +178,23 @@ QHash<QString, int> qSqlRecordIndexOf;
 QSqlRecord QSqlQuery::record() const
 {
     qSqlRecordIndexOf.clear();
-    if (qSqlQueryExecQuery.last() == "SELECT * FROM notifications") {
+    const QString query(qSqlQueryState.value(this).first);
+    if (query == "SELECT * FROM notifications ORDER BY id") {
         qSqlRecordIndexOf.insert("id", 0);
         qSqlRecordIndexOf.insert("app_name", 1);
         qSqlRecordIndexOf.insert("app_icon", 2);
         qSqlRecordIndexOf.insert("summary", 3);
         qSqlRecordIndexOf.insert("body", 4);
         qSqlRecordIndexOf.insert("expire_timeout", 5);
-    } else if (qSqlQueryExecQuery.last() == "SELECT * FROM actions") {
+        qSqlRecordIndexOf.insert("hints", 6);
+    } else if (query == "SELECT * FROM actions ORDER BY id, rowid") {
         qSqlRecordIndexOf.insert("id", 0);
         qSqlRecordIndexOf.insert("action", 1);
-    } else if (qSqlQueryExecQuery.last() == "SELECT * FROM hints") {
+    } else if (query == "SELECT * FROM hints") {
         qSqlRecordIndexOf.insert("id", 0);
         qSqlRecordIndexOf.insert("hint", 1);
         qSqlRecordIndexOf.insert("value", 2);
-    } else if (qSqlQueryExecQuery.last() == "SELECT * FROM expiration") {
+    } else if (query == "SELECT * FROM expiration") {
         qSqlRecordIndexOf.insert("id", 0);
         qSqlRecordIndexOf.insert("expire_at", 1);
     }
@@ -174,8 +206,9 @@ typedef QList<QueryValues> QueryValueList;
 QHash<QString, QueryValueList> qSqlQueryValues;
 bool QSqlQuery::next()
 {
-    if (qSqlQueryIndex < qSqlQueryValues.value(qSqlQueryExecQuery.last()).count() - 1) {
-        qSqlQueryIndex++;
+    QPair<QString, int> &state(qSqlQueryState[this]);
+    if (state.second < qSqlQueryValues.value(state.first).count() - 1) {
+        state.second++;
         return true;
     } else {
         return false;
@@ -184,7 +217,8 @@ bool QSqlQuery::next()
 
 QVariant QSqlQuery::value(int i) const
 {
-    return qSqlQueryValues.value(qSqlQueryExecQuery.last()).at(qSqlQueryIndex).value(i);
+    const QPair<QString, int> state(qSqlQueryState.value(this));
+    return qSqlQueryValues.value(state.first).at(state.second).value(i);
 }
 
 int QSqlRecord::indexOf(const QString &name) const
@@ -212,6 +246,7 @@ int QSqlTableModel::fieldIndex(const QString &fieldName) const
         notificationsTableFieldIndices.insert("summary", 3);
         notificationsTableFieldIndices.insert("body", 4);
         notificationsTableFieldIndices.insert("expire_timeout", 5);
+        notificationsTableFieldIndices.insert("hints", 6);
 
         actionsTableFieldIndices.insert("id", 0);
         actionsTableFieldIndices.insert("action", 1);
@@ -258,7 +293,10 @@ void MRemoteAction::trigger()
 void Ut_NotificationManager::init()
 {
     qSqlQueryExecQuery.clear();
+    qSqlQueryState.clear();
     qSqlQueryPrepare.clear();
+    qSqlQueryPreparedStatement.clear();
+    qSqlQueryExecPrepared.clear();
     qSqlQueryAddBindValue.clear();
     qSqlQueryValues.clear();
     qSqlDatabaseAddDatabaseType.clear();
@@ -322,20 +360,19 @@ void Ut_NotificationManager::testDatabaseConnectionSucceedsAndTablesAreNotOk()
     QCOMPARE(qSqlQueryExecQuery.at(0), QString("PRAGMA journal_mode=WAL"));
     QCOMPARE(qSqlQueryExecQuery.at(1), QString("PRAGMA user_version"));
     QCOMPARE(qSqlQueryExecQuery.at(2), QString("DROP TABLE notifications"));
-    QCOMPARE(qSqlQueryExecQuery.at(3), QString("CREATE TABLE notifications (id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER)"));
-    QCOMPARE(qSqlQueryExecQuery.at(4), QString("DROP TABLE actions"));
-    QCOMPARE(qSqlQueryExecQuery.at(5), QString("CREATE TABLE actions (id INTEGER, action TEXT, PRIMARY KEY(id, action))"));
-    QCOMPARE(qSqlQueryExecQuery.at(6), QString("DROP TABLE hints"));
-    QCOMPARE(qSqlQueryExecQuery.at(7), QString("CREATE TABLE hints (id INTEGER, hint TEXT, value TEXT, PRIMARY KEY(id, hint))"));
-    QCOMPARE(qSqlQueryExecQuery.at(8), QString("DROP TABLE expiration"));
-    QCOMPARE(qSqlQueryExecQuery.at(9), QString("CREATE TABLE expiration (id INTEGER PRIMARY KEY, expire_at INTEGER)"));
-    QCOMPARE(qSqlQueryExecQuery.at(10), QString("SELECT * FROM actions"));
-    QCOMPARE(qSqlQueryExecQuery.at(11), QString("SELECT * FROM hints"));
-    QCOMPARE(qSqlQueryExecQuery.at(12), QString("SELECT * FROM expiration"));
-    QCOMPARE(qSqlQueryExecQuery.at(13), QString("SELECT * FROM notifications"));
+    QCOMPARE(qSqlQueryExecQuery.at(3), QString("CREATE TABLE notifications (id INTEGER PRIMARY KEY, app_name TEXT, app_icon TEXT, summary TEXT, body TEXT, expire_timeout INTEGER, hints BLOB)"));
+    QCOMPARE(qSqlQueryExecQuery.at(4), QString("DROP TABLE IF EXISTS hints"));
+    QCOMPARE(qSqlQueryExecQuery.at(5), QString("DROP TABLE actions"));
+    QCOMPARE(qSqlQueryExecQuery.at(6), QString("CREATE TABLE actions (id INTEGER, action TEXT, PRIMARY KEY(id, action))"));
+    QCOMPARE(qSqlQueryExecQuery.at(7), QString("DROP TABLE expiration"));
+    QCOMPARE(qSqlQueryExecQuery.at(8), QString("CREATE TABLE expiration (id INTEGER PRIMARY KEY, expire_at INTEGER)"));
+    QCOMPARE(qSqlQueryExecQuery.at(9), QString("CREATE INDEX IF NOT EXISTS expiration_expire_at ON expiration(expire_at)"));
+    QCOMPARE(qSqlQueryExecQuery.at(10), QString("PRAGMA user_version=3"));
+    QCOMPARE(qSqlQueryExecQuery.at(11), QString("SELECT * FROM expiration"));
+    QCOMPARE(qSqlQueryExecQuery.at(12), QString("SELECT * FROM notifications ORDER BY id"));
+    QCOMPARE(qSqlQueryExecQuery.at(13), QString("SELECT * FROM actions ORDER BY id, rowid"));
     QCOMPARE((bool)modelToTableName.values().contains("notifications"), true);
     QCOMPARE((bool)modelToTableName.values().contains("actions"), true);
-    QCOMPARE((bool)modelToTableName.values().contains("hints"), true);
     QCOMPARE((bool)modelToTableName.values().contains("expiration"), true);
     notificationsTableFieldIndices.clear();
     actionsTableFieldIndices.clear();
@@ -343,6 +380,55 @@ void Ut_NotificationManager::testDatabaseConnectionSucceedsAndTablesAreNotOk()
     expirationTableFieldIndices.clear();
 }
 
+void Ut_NotificationManager::testHintsAreMigratedToNotificationsTable()
+{
+    // Set up the notifications table without the hints column and the hints in a table of their own
+    notificationsTableFieldIndices.clear();
+    notificationsTableFieldIndices.insert("id", 0);
+    notificationsTableFieldIndices.insert("app_name", 1);
+    notificationsTableFieldIndices.insert("app_icon", 2);
+    notificationsTableFieldIndices.insert("summary", 3);
+    notificationsTableFieldIndices.insert("body", 4);
+    notificationsTableFieldIndices.insert("expire_timeout", 5);
+    actionsTableFieldIndices.insert("id", 0);
+    actionsTableFieldIndices.insert("action", 1);
+    hintsTableFieldIndices.insert("id", 0);
+    hintsTableFieldIndices.insert("hint", 1);
+    hintsTableFieldIndices.insert("value", 2);
+    expirationTableFieldIndices.insert("id", 0);
+    expirationTableFieldIndices.insert("expire_at", 1);
+
+    QHash<int, QVariant> hint;
+    QHash<int, QVariant> timestampHint;
+    hint.insert(0, 1);
+    hint.insert(1, "hint1");
+    hint.insert(2, "value1");
+    timestampHint.insert(0, 1);
+    timestampHint.insert(1, "x-nemo-timestamp");
+    timestampHint.insert(2, "2015-01-01T12:00:00");
+    qSqlQueryValues["SELECT * FROM hints"] << hint << timestampHint;
+
+    // Check that the hints are moved to the notifications table without recreating it
+    NotificationManager::instance();
+    QCOMPARE(qSqlQueryExecQuery.contains("DROP TABLE notifications"), false);
+    QCOMPARE(qSqlQueryExecQuery.contains("ALTER TABLE notifications ADD COLUMN hints BLOB"), true);
+    QCOMPARE(qSqlQueryExecQuery.contains("DROP TABLE IF EXISTS hints"), true);
+    QCOMPARE(qSqlQueryPrepare, QStringList() << "UPDATE notifications SET hints=? WHERE id=?");
+    QCOMPARE(qSqlQueryExecPrepared, QStringList() << "UPDATE notifications SET hints=? WHERE id=?");
+    QCOMPARE(qSqlQueryAddBindValue.count(), 2);
+    const QVariantHash storedHints(deserializedHints(qSqlQueryAddBindValue.at(0)));
+    QCOMPARE(storedHints.count(), 2);
+    QCOMPARE(storedHints.value("hint1"), QVariant("value1"));
+    QCOMPARE(storedHints.value("x-nemo-timestamp"), QVariant(QDateTime(QDate(2015, 1, 1), QTime(12, 0), Qt::UTC).toString(Qt::ISODate)));
+    QCOMPARE(qSqlQueryAddBindValue.at(1).toUInt(), (uint)1);
+    QCOMPARE(qSqlDatabaseCommitCalled, true);
+
+    notificationsTableFieldIndices.clear();
+    actionsTableFieldIndices.clear();
+    hintsTableFieldIndices.clear();
+    expirationTableFieldIndices.clear();
+}
+
 void Ut_NotificationManager::testFirstDatabaseConnectionFails()
 {
     // Make the first database connection fail but the second to succeed
@@ -353,7 +439,7 @@ void Ut_NotificationManager::testFirstDatabaseConnectionFails()
     // Check that the old database is removed, the database opened twice and the database opened as expected on the second time
     QCOMPARE(qDirRemoveCalled, true);
     QCOMPARE(qSqlDatabaseOpenCalledCount, 2);
-    QCOMPARE(qSqlQueryExecQuery.count(), 6);
+    QCOMPARE(qSqlQueryExecQuery.count(), 7);
 }
 
 void Ut_NotificationManager::testNotEnoughDiskSpaceToOpenDatabase()
@@ -405,7 +491,7 @@ void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
     notification4Values.insert(5, 4);
     QList<QHash<int, QVariant> > notificationValues;
     notificationValues << notification1Values << notification2Values << notification3Values << notification4Values;
-    qSqlQueryValues["SELECT * FROM notifications"].append(notificationValues);
+    qSqlQueryValues["SELECT * FROM notifications ORDER BY id"].append(notificationValues);
     QHash<uint, QHash<int, QVariant> > notificationValuesById;
     notificationValuesById.insert(1, notification1Values);
     notificationValuesById.insert(2, notification2Values);
@@ -430,48 +516,30 @@ void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
     notification3ActionName.insert(1, "Action 3");
     QList<QHash<int, QVariant> > notificationActions;
     notificationActions << notification1ActionIdentifier << notification1ActionName << notification2ActionIdentifier << notification2ActionName << notification3ActionIdentifier << notification3ActionName;
-    qSqlQueryValues["SELECT * FROM actions"].append(notificationActions);
+    qSqlQueryValues["SELECT * FROM actions ORDER BY id, rowid"].append(notificationActions);
     QHash<uint, QStringList> notificationActionsById;
     notificationActionsById.insert(1, QStringList() << "action1" << "Action 1");
     notificationActionsById.insert(2, QStringList() << "action2" << "Action 2");
 
     const QDateTime timestamp(QDateTime::currentDateTimeUtc());
     const QDateTime earlyTimestamp(QDateTime::currentDateTimeUtc().addSecs(-1));
-    QHash<int, QVariant> notification1Hint1;
-    QHash<int, QVariant> notification1Hint2;
-    QHash<int, QVariant> notification2Hint1;
-    QHash<int, QVariant> notification2Hint2;
-    QHash<int, QVariant> notification3Hint1;
-    QHash<int, QVariant> notification3Hint2;
-    QHash<int, QVariant> notification4Hint1;
-    QHash<int, QVariant> notification4Hint2;
-    notification1Hint1.insert(0, 1);
-    notification1Hint1.insert(1, "hint1");
-    notification1Hint1.insert(2, "value1");
-    notification1Hint2.insert(0, 1);
-    notification1Hint2.insert(1, "x-nemo-timestamp");
-    notification1Hint2.insert(2, timestamp);
-    notification2Hint1.insert(0, 2);
-    notification2Hint1.insert(1, "hint2");
-    notification2Hint1.insert(2, "value2");
-    notification2Hint2.insert(0, 2);
-    notification2Hint2.insert(1, "x-nemo-timestamp");
-    notification2Hint2.insert(2, timestamp);
-    notification3Hint1.insert(0, 3);
-    notification3Hint1.insert(1, "hint3");
-    notification3Hint1.insert(2, "value3");
-    notification3Hint2.insert(0, 3);
-    notification3Hint2.insert(1, "x-nemo-timestamp");
-    notification3Hint2.insert(2, timestamp);
-    notification4Hint1.insert(0, 4);
-    notification4Hint1.insert(1, "hint4");
-    notification4Hint1.insert(2, "value4");
-    notification4Hint2.insert(0, 4);
-    notification4Hint2.insert(1, "x-nemo-timestamp");
-    notification4Hint2.insert(2, earlyTimestamp);
-    QList<QHash<int, QVariant> > notificationHints;
-    notificationHints << notification1Hint1 << notification1Hint2 << notification2Hint1 << notification2Hint2 << notification3Hint1 << notification3Hint2 << notification4Hint1 << notification4Hint2;
-    qSqlQueryValues["SELECT * FROM hints"].append(notificationHints);
+    QVariantHash notification1Hints;
+    QVariantHash notification2Hints;
+    QVariantHash notification3Hints;
+    QVariantHash notification4Hints;
+    notification1Hints.insert("hint1", "value1");
+    notification1Hints.insert("x-nemo-timestamp", timestamp);
+    notification2Hints.insert("hint2", "value2");
+    notification2Hints.insert("x-nemo-timestamp", timestamp);
+    notification3Hints.insert("hint3", "value3");
+    notification3Hints.insert("x-nemo-timestamp", timestamp);
+    notification4Hints.insert("hint4", "value4");
+    notification4Hints.insert("x-nemo-timestamp", earlyTimestamp);
+    QueryValueList &storedNotifications(qSqlQueryValues["SELECT * FROM notifications ORDER BY id"]);
+    storedNotifications[0].insert(6, serializedHints(notification1Hints));
+    storedNotifications[1].insert(6, serializedHints(notification2Hints));
+    storedNotifications[2].insert(6, serializedHints(notification3Hints));
+    storedNotifications[3].insert(6, serializedHints(notification4Hints));
     QHash<uint, QList<QPair<QString, QVariant> > > notificationHintsById;
     notificationHintsById.insert(1, QList<QPair<QString, QVariant> >() << qMakePair(QString("hint1"), QVariant("value1")) << qMakePair(QString("x-nemo-timestamp"), QVariant(timestamp)));
     notificationHintsById.insert(2, QList<QPair<QString, QVariant> >() << qMakePair(QString("hint2"), QVariant("value2")) << qMakePair(QString("x-nemo-timestamp"), QVariant(timestamp)));
@@ -514,6 +582,7 @@ void Ut_NotificationManager::testNotificationsAreRestoredOnConstruction()
 
 void Ut_NotificationManager::testDatabaseCommitIsDoneOnDestruction()
 {
+    NotificationManager::instance()->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
     delete NotificationManager::instance();
     NotificationManager::instance_ = 0;
 
@@ -557,40 +626,27 @@ void Ut_NotificationManager::testAddingNotification()
     QCOMPARE(modifiedSpy.last().at(0).toUInt(), id);
     QCOMPARE(addedSpy.count(), 1);
     QCOMPARE(addedSpy.last().at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryPrepare.count(), 6);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?)"));
+    manager->flushDatabase();
+    QCOMPARE(qSqlQueryPrepare.count(), 2);
+    QCOMPARE(qSqlQueryPrepare.at(0), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)"));
     QCOMPARE(qSqlQueryPrepare.at(1), QString("INSERT INTO actions VALUES (?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(2), QString("INSERT INTO actions VALUES (?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(3), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(4), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(5), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 19);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 2);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryExecPrepared.at(1), QString("INSERT INTO actions VALUES (?, ?)"));
+    QCOMPARE(qSqlQueryAddBindValue.count(), 9);
     QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
     QCOMPARE(qSqlQueryAddBindValue.at(1), QVariant("appName"));
     QCOMPARE(qSqlQueryAddBindValue.at(2), QVariant("appIcon"));
     QCOMPARE(qSqlQueryAddBindValue.at(3), QVariant("summary"));
     QCOMPARE(qSqlQueryAddBindValue.at(4), QVariant("body"));
     QCOMPARE(qSqlQueryAddBindValue.at(5).toInt(), 1);
-    QCOMPARE(qSqlQueryAddBindValue.at(6).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(7), QVariant("action"));
-    QCOMPARE(qSqlQueryAddBindValue.at(8).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(9), QVariant("Action"));
-    QStringList keys(QStringList() << "hint" << NotificationManager::HINT_TIMESTAMP << NotificationManager::HINT_PRIORITY);
-    for (int i = 10; i <= 16; i += 3) {
-        QCOMPARE(qSqlQueryAddBindValue.at(i).toUInt(), id);
-        QString key(qSqlQueryAddBindValue.at(i + 1).toString());
-        if (key == "hint") {
-            QCOMPARE(qSqlQueryAddBindValue.at(i + 2), QVariant("value"));
-            keys.removeAll(key);
-        } else if (key == NotificationManager::HINT_TIMESTAMP) {
-            QCOMPARE(qSqlQueryAddBindValue.at(i + 2).type(), QVariant::String);
-            keys.removeAll(key);
-        } else if (key == NotificationManager::HINT_PRIORITY) {
-            QCOMPARE(qSqlQueryAddBindValue.at(i + 2).type(), QVariant::Int);
-            keys.removeAll(key);
-        }
-    }
-    QCOMPARE(keys.count(), 0);
+    const QVariantHash storedHints(deserializedHints(qSqlQueryAddBindValue.at(6)));
+    QCOMPARE(storedHints.count(), 3);
+    QCOMPARE(storedHints.value("hint"), QVariant("value"));
+    QCOMPARE(storedHints.value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::String);
+    QCOMPARE(storedHints.value(NotificationManager::HINT_PRIORITY).type(), QVariant::Int);
+    QCOMPARE(qSqlQueryAddBindValue.at(7).toList(), QVariantList() << id << id);
+    QCOMPARE(qSqlQueryAddBindValue.at(8).toList(), QVariantList() << "action" << "Action");
     QCOMPARE(notification->appName(), QString("appName"));
     QCOMPARE(notification->appIcon(), QString("appIcon"));
     QCOMPARE(notification->summary(), QString("summary"));
@@ -608,7 +664,9 @@ void Ut_NotificationManager::testUpdatingExistingNotification()
     NotificationManager *manager = NotificationManager::instance();
 
     uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    manager->flushDatabase();
     qSqlQueryPrepare.clear();
+    qSqlQueryExecPrepared.clear();
     qSqlQueryAddBindValue.clear();
 
     QSignalSpy modifiedSpy(manager, SIGNAL(notificationModified(uint)));
@@ -620,41 +678,30 @@ void Ut_NotificationManager::testUpdatingExistingNotification()
     QTRY_COMPARE(modifiedSpy.count(), 1);
     QCOMPARE(modifiedSpy.last().at(0).toUInt(), id);
     QCOMPARE(addedSpy.count(), 0);
-    QCOMPARE(qSqlQueryPrepare.count(), 8);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("DELETE FROM notifications WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(1), QString("DELETE FROM actions WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(2), QString("DELETE FROM hints WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(3), QString("DELETE FROM expiration WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(4), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(5), QString("INSERT INTO actions VALUES (?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(6), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryPrepare.at(7), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 18);
+    manager->flushDatabase();
+    QCOMPARE(qSqlQueryExecPrepared.count(), 5);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("DELETE FROM notifications WHERE id=?"));
+    QCOMPARE(qSqlQueryExecPrepared.at(1), QString("DELETE FROM actions WHERE id=?"));
+    QCOMPARE(qSqlQueryExecPrepared.at(2), QString("DELETE FROM expiration WHERE id=?"));
+    QCOMPARE(qSqlQueryExecPrepared.at(3), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryExecPrepared.at(4), QString("INSERT INTO actions VALUES (?, ?)"));
+    // Only the statements not used by the first notification need to be prepared
+    QCOMPARE(qSqlQueryPrepare.count(), 4);
+    QCOMPARE(qSqlQueryAddBindValue.count(), 12);
     QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
     QCOMPARE(qSqlQueryAddBindValue.at(1).toUInt(), id);
     QCOMPARE(qSqlQueryAddBindValue.at(2).toUInt(), id);
     QCOMPARE(qSqlQueryAddBindValue.at(3).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(4).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(5), QVariant("newAppName"));
-    QCOMPARE(qSqlQueryAddBindValue.at(6), QVariant("newAppIcon"));
-    QCOMPARE(qSqlQueryAddBindValue.at(7), QVariant("newSummary"));
-    QCOMPARE(qSqlQueryAddBindValue.at(8), QVariant("newBody"));
-    QCOMPARE(qSqlQueryAddBindValue.at(9).toInt(), 2);
-    QCOMPARE(qSqlQueryAddBindValue.at(10).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(11), QVariant("action"));
-    QStringList keys(QStringList() << NotificationManager::HINT_TIMESTAMP << NotificationManager::HINT_PRIORITY);
-    for (int i = 12; i <= 15; i += 3) {
-        QCOMPARE(qSqlQueryAddBindValue.at(i).toUInt(), id);
-        QString key(qSqlQueryAddBindValue.at(i + 1).toString());
-        if (key == NotificationManager::HINT_TIMESTAMP) {
-            QCOMPARE(qSqlQueryAddBindValue.at(i + 2).type(), QVariant::String);
-            keys.removeAll(key);
-        } else if (key == NotificationManager::HINT_PRIORITY) {
-            QCOMPARE(qSqlQueryAddBindValue.at(i + 2).type(), QVariant::Int);
-            keys.removeAll(key);
-        }
-    }
-    QCOMPARE(keys.count(), 0);
+    QCOMPARE(qSqlQueryAddBindValue.at(4), QVariant("newAppName"));
+    QCOMPARE(qSqlQueryAddBindValue.at(5), QVariant("newAppIcon"));
+    QCOMPARE(qSqlQueryAddBindValue.at(6), QVariant("newSummary"));
+    QCOMPARE(qSqlQueryAddBindValue.at(7), QVariant("newBody"));
+    QCOMPARE(qSqlQueryAddBindValue.at(8).toInt(), 2);
+    const QVariantHash storedHints(deserializedHints(qSqlQueryAddBindValue.at(9)));
+    QCOMPARE(storedHints.value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::String);
+    QCOMPARE(storedHints.value(NotificationManager::HINT_PRIORITY).type(), QVariant::Int);
+    QCOMPARE(qSqlQueryAddBindValue.at(10).toList(), QVariantList() << id);
+    QCOMPARE(qSqlQueryAddBindValue.at(11).toList(), QVariantList() << "action");
     QCOMPARE(notification->appName(), QString("newAppName"));
     QCOMPARE(notification->appIcon(), QString("newAppIcon"));
     QCOMPARE(notification->summary(), QString("newSummary"));
@@ -664,6 +711,25 @@ void Ut_NotificationManager::testUpdatingExistingNotification()
     QCOMPARE(notification->hints().value(NotificationManager::HINT_TIMESTAMP).type(), QVariant::String);
 }
 
+void Ut_NotificationManager::testPreparedStatementsAreReused()
+{
+    NotificationManager *manager = NotificationManager::instance();
+
+    QVariantHash hints;
+    hints.insert("hint1", "value1");
+    hints.insert("hint2", "value2");
+    manager->Notify("appName1", 0, "appIcon1", "summary1", "body1", QStringList() << "action1" << "Action 1", hints, 1);
+    manager->Notify("appName2", 0, "appIcon2", "summary2", "body2", QStringList() << "action2" << "Action 2", hints, 1);
+    manager->flushDatabase();
+
+    // Each statement should be prepared only once however many times it is executed
+    QCOMPARE(qSqlQueryPrepare.count(), 2);
+    QCOMPARE(qSqlQueryPrepare.count("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)"), 1);
+    QCOMPARE(qSqlQueryPrepare.count("INSERT INTO actions VALUES (?, ?)"), 1);
+    QCOMPARE(qSqlQueryExecPrepared.count("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)"), 2);
+    QCOMPARE(qSqlQueryExecPrepared.count("INSERT INTO actions VALUES (?, ?)"), 2);
+}
+
 void Ut_NotificationManager::testUpdatingInexistingNotification()
 {
     NotificationManager *manager = NotificationManager::instance();
@@ -674,14 +740,18 @@ void Ut_NotificationManager::testUpdatingInexistingNotification()
     QTest::qWait(1100);
     QCOMPARE(modifiedSpy.count(), 0);
     QCOMPARE(addedSpy.count(), 0);
+    manager->flushDatabase();
     QCOMPARE(qSqlQueryPrepare.count(), 0);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 0);
 }
 
 void Ut_NotificationManager::testRemovingExistingNotification()
 {
     NotificationManager *manager = NotificationManager::instance();
     uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    manager->flushDatabase();
     qSqlQueryPrepare.clear();
+    qSqlQueryExecPrepared.clear();
     qSqlQueryAddBindValue.clear();
 
     QSignalSpy removedSpy(manager, SIGNAL(notificationRemoved(uint)));
@@ -692,16 +762,15 @@ void Ut_NotificationManager::testRemovingExistingNotification()
     QCOMPARE(closedSpy.count(), 1);
     QCOMPARE(closedSpy.last().at(0).toUInt(), id);
     QCOMPARE(closedSpy.last().at(1).toInt(), (int)NotificationManager::CloseNotificationCalled);
-    QCOMPARE(qSqlQueryPrepare.count(), 4);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("DELETE FROM notifications WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(1), QString("DELETE FROM actions WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(2), QString("DELETE FROM hints WHERE id=?"));
-    QCOMPARE(qSqlQueryPrepare.at(3), QString("DELETE FROM expiration WHERE id=?"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 4);
+    manager->flushDatabase();
+    QCOMPARE(qSqlQueryExecPrepared.count(), 3);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("DELETE FROM notifications WHERE id=?"));
+    QCOMPARE(qSqlQueryExecPrepared.at(1), QString("DELETE FROM actions WHERE id=?"));
+    QCOMPARE(qSqlQueryExecPrepared.at(2), QString("DELETE FROM expiration WHERE id=?"));
+    QCOMPARE(qSqlQueryAddBindValue.count(), 3);
     QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
     QCOMPARE(qSqlQueryAddBindValue.at(1).toUInt(), id);
     QCOMPARE(qSqlQueryAddBindValue.at(2).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(3).toUInt(), id);
 }
 
 void Ut_NotificationManager::testRemovingInexistingNotification()
@@ -712,7 +781,9 @@ void Ut_NotificationManager::testRemovingInexistingNotification()
     manager->CloseNotification(1);
     QCOMPARE(removedSpy.count(), 0);
     QCOMPARE(closedSpy.count(), 0);
+    manager->flushDatabase();
     QCOMPARE(qSqlQueryPrepare.count(), 0);
+    QCOMPARE(qSqlQueryExecPrepared.count(), 0);
 }
 
 void Ut_NotificationManager::testServerInformation()
@@ -789,6 +860,30 @@ void Ut_NotificationManager::testUninstallingCategoryDefinitionRemovesNotificati
     QCOMPARE(manager->notification(id2), (LipstickNotification *)0);
 }
 
+void Ut_NotificationManager::testReplacingNotificationUpdatesCategory()
+{
+    NotificationManager *manager = NotificationManager::instance();
+
+    // Add a notification with category "category1" and replace it with one with category "category2"
+    QVariantHash hints1;
+    QVariantHash hints2;
+    hints1.insert(NotificationManager::HINT_CATEGORY, "category1");
+    hints2.insert(NotificationManager::HINT_CATEGORY, "category2");
+    uint id = manager->Notify("app", 0, QString(), QString(), QString(), QStringList(), hints1, 0);
+    QCOMPARE(manager->Notify("app", id, QString(), QString(), QString(), QStringList(), hints2, 0), id);
+
+    // The notification should no longer be removed with its previous category
+    QSignalSpy removedSpy(manager, SIGNAL(notificationRemoved(uint)));
+    manager->removeNotificationsWithCategory("category1");
+    QCOMPARE(removedSpy.count(), 0);
+    QVERIFY(manager->notification(id) != 0);
+
+    manager->removeNotificationsWithCategory("category2");
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(removedSpy.last().at(0).toUInt(), id);
+    QCOMPARE(manager->notification(id), (LipstickNotification *)0);
+}
+
 void Ut_NotificationManager::testActionIsInvokedIfDefined()
 {
     // Add two notifications, only the first one with an action named "action1"
@@ -901,7 +996,8 @@ void Ut_NotificationManager::testInvokingActionRemovesNotificationIfUserRemovabl
     uint id = manager->Notify("app2", 0, QString(), QString(), QString(), QStringList(), hints, 0);
     LipstickNotification *notification = manager->notification(id);
     connect(this, SIGNAL(actionInvoked(QString)), notification, SIGNAL(actionInvoked(QString)));
-    qSqlQueryPrepare.clear();
+    manager->flushDatabase();
+    qSqlQueryExecPrepared.clear();
     qSqlQueryAddBindValue.clear();
 
     // Make the notifications emit the actionInvoked() signal for action "action"; removable notifications should get removed but non-closeable should not be closed
@@ -914,12 +1010,14 @@ void Ut_NotificationManager::testInvokingActionRemovesNotificationIfUserRemovabl
     QCOMPARE(closedSpy.count(), 0);
 
     // Check that the notification was marked hidden
-    QCOMPARE(qSqlQueryPrepare.count(), 1);
-    QCOMPARE(qSqlQueryPrepare.at(0), QString("INSERT INTO hints VALUES (?, ?, ?)"));
-    QCOMPARE(qSqlQueryAddBindValue.count(), 3);
-    QCOMPARE(qSqlQueryAddBindValue.at(0).toUInt(), id);
-    QCOMPARE(qSqlQueryAddBindValue.at(1), QVariant(NotificationManager::HINT_HIDDEN));
-    QCOMPARE(qSqlQueryAddBindValue.at(2), QVariant(true));
+    manager->flushDatabase();
+    QCOMPARE(qSqlQueryExecPrepared.count(), 1);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("UPDATE notifications SET hints=? WHERE id=?"));
+    QCOMPARE(qSqlQueryAddBindValue.count(), 2);
+    const QVariantHash storedHints(deserializedHints(qSqlQueryAddBindValue.at(0)));
+    QCOMPARE(storedHints.value(NotificationManager::HINT_HIDDEN), QVariant(true));
+    QCOMPARE(storedHints.value(NotificationManager::HINT_USER_CLOSEABLE), QVariant(false));
+    QCOMPARE(qSqlQueryAddBindValue.at(1).toUInt(), id);
 }
 
 void Ut_NotificationManager::testListingNotifications()
@@ -1065,15 +1163,6 @@ void Ut_NotificationManager::testDelayedExpiration()
     uint id1 = manager->Notify("app1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 200);
     uint id2 = manager->Notify("app2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 100);
 
-    QueryValues expirationValues1, expirationValues2;
-    expirationValues1.insert(0, id1);
-    expirationValues1.insert(1, QDateTime::currentDateTimeUtc().toMSecsSinceEpoch() + 200);
-    expirationValues2.insert(0, id2);
-    expirationValues2.insert(1, QDateTime::currentDateTimeUtc().toMSecsSinceEpoch() + 100);
-
-    qSqlQueryValues.clear();
-    qSqlQueryValues["SELECT * FROM expiration"] = QueryValueList() << expirationValues1;
-
     QSignalSpy removedSpy(manager, SIGNAL(notificationRemoved(uint)));
     QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
     manager->MarkNotificationDisplayed(id1);
@@ -1081,7 +1170,6 @@ void Ut_NotificationManager::testDelayedExpiration()
     QCOMPARE(removedSpy.count(), 0);
     QCOMPARE(closedSpy.count(), 0);
 
-    qSqlQueryValues["SELECT * FROM expiration"] = QueryValueList() << expirationValues1 << expirationValues2;
     manager->MarkNotificationDisplayed(id2);
 
     QCoreApplication::processEvents();
@@ -1094,8 +1182,6 @@ void Ut_NotificationManager::testDelayedExpiration()
     QCOMPARE(closedSpy.last().at(0).toUInt(), id2);
     QCOMPARE(closedSpy.last().at(1).toUInt(), static_cast<uint>(NotificationManager::NotificationExpired));
 
-    qSqlQueryValues["SELECT * FROM expiration"] = QueryValueList() << expirationValues1;
-
     QTRY_COMPARE(removedSpy.count(), 2);
     QCOMPARE(removedSpy.last().at(0).toUInt(), id1);
     QCOMPARE(closedSpy.count(), 2);
@@ -1103,4 +1189,149 @@ void Ut_NotificationManager::testDelayedExpiration()
     QCOMPARE(closedSpy.last().at(1).toUInt(), static_cast<uint>(NotificationManager::NotificationExpired));
 }
 
+void Ut_NotificationManager::testFlushingDatabase()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", QStringList(), QVariantHash(), 1);
+    manager->CloseNotification(id);
+
+    // Flushing should execute the queued commands in order and commit them
+    manager->flushDatabase();
+    QCOMPARE(qSqlQueryExecPrepared.count(), 4);
+    QCOMPARE(qSqlQueryExecPrepared.at(0), QString("INSERT INTO notifications VALUES (?, ?, ?, ?, ?, ?, ?)"));
+    QCOMPARE(qSqlQueryExecPrepared.at(1), QString("DELETE FROM notifications WHERE id=?"));
+    QCOMPARE(qSqlQueryExecPrepared.at(3), QString("DELETE FROM expiration WHERE id=?"));
+    QCOMPARE(qSqlDatabaseCommitCalled, true);
+
+    // Nothing should be committed when there are no modifications
+    qSqlDatabaseCommitCalled = false;
+    manager->flushDatabase();
+    QCOMPARE(qSqlDatabaseCommitCalled, false);
+}
+
+void Ut_NotificationManager::testClosedNotificationIsNotExpired()
+{
+    NotificationManager *manager = NotificationManager::instance();
+    uint id1 = manager->Notify("app1", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 100);
+    uint id2 = manager->Notify("app2", 0, QString(), QString(), QString(), QStringList(), QVariantHash(), 200);
+    manager->MarkNotificationDisplayed(id1);
+    manager->MarkNotificationDisplayed(id2);
+    QCOMPARE(manager->expirationTimes.count(), 2);
+
+    // Closing a displayed notification should remove it from the expiration queue
+    manager->CloseNotification(id1);
+    QCOMPARE(manager->expirationTimes.contains(id1), false);
+
+    QSignalSpy closedSpy(manager, SIGNAL(NotificationClosed(uint,uint)));
+    QTRY_COMPARE(closedSpy.count(), 1);
+    QCOMPARE(closedSpy.last().at(0).toUInt(), id2);
+    QCOMPARE(closedSpy.last().at(1).toUInt(), static_cast<uint>(NotificationManager::NotificationExpired));
+    QCOMPARE(manager->expirationTimes.isEmpty(), true);
+    QCOMPARE(manager->expirationQueue.isEmpty(), true);
+}
+
+void Ut_NotificationManager::benchmarkReplacingNotification_data()
+{
+    QTest::addColumn<int>("hintCount");
+    QTest::newRow("0 hints") << 0;
+    QTest::newRow("10 hints") << 10;
+    QTest::newRow("50 hints") << 50;
+}
+
+void Ut_NotificationManager::benchmarkReplacingNotification()
+{
+    QFETCH(int, hintCount);
+
+    NotificationManager *manager = NotificationManager::instance();
+    QVariantHash hints;
+    for (int i = 0; i < hintCount; ++i) {
+        hints.insert(QString("hint%1").arg(i), QString("value%1").arg(i));
+    }
+    const QStringList actions(QStringList() << "action1" << "Action 1" << "action2" << "Action 2");
+    uint id = manager->Notify("appName", 0, "appIcon", "summary", "body", actions, hints, 1);
+    manager->flushDatabase();
+
+    // Replacing a notification should take a fixed number of statements regardless of its hint count
+    qSqlQueryExecPrepared.clear();
+    manager->Notify("appName", id, "appIcon", "summary", "body", actions, hints, 1);
+    manager->flushDatabase();
+    QCOMPARE(qSqlQueryExecPrepared.count(), 5);
+
+    QBENCHMARK {
+        manager->Notify("appName", id, "appIcon", "summary", "body", actions, hints, 1);
+        manager->flushDatabase();
+        qSqlQueryExecPrepared.clear();
+        qSqlQueryAddBindValue.clear();
+    }
+}
+
+void Ut_NotificationManager::benchmarkRestoringNotifications()
+{
+    const int notificationCount = 5000;
+    const int oldValue = MaxNotificationRestoreCount;
+    MaxNotificationRestoreCount = notificationCount;
+
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_CATEGORY, "x-nemo.email");
+    hints.insert(NotificationManager::HINT_TIMESTAMP, QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    const QByteArray storedHints(serializedHints(hints));
+    for (int id = 1; id <= notificationCount; ++id) {
+        QueryValues notificationValues;
+        notificationValues.insert(0, id);
+        notificationValues.insert(1, "appName");
+        notificationValues.insert(2, "appIcon");
+        notificationValues.insert(3, QString("summary%1").arg(id));
+        notificationValues.insert(4, QString("body%1").arg(id));
+        notificationValues.insert(5, -1);
+        notificationValues.insert(6, storedHints);
+        qSqlQueryValues["SELECT * FROM notifications ORDER BY id"].append(notificationValues);
+
+        QueryValues actionIdentifier;
+        actionIdentifier.insert(0, id);
+        actionIdentifier.insert(1, "default");
+        QueryValues actionName;
+        actionName.insert(0, id);
+        actionName.insert(1, "Open");
+        qSqlQueryValues["SELECT * FROM actions ORDER BY id, rowid"] << actionIdentifier << actionName;
+    }
+
+    QBENCHMARK {
+        NotificationManager *manager = NotificationManager::instance();
+        QCOMPARE(manager->notificationIds().count(), notificationCount);
+        delete manager;
+        NotificationManager::instance_ = 0;
+    }
+
+    MaxNotificationRestoreCount = oldValue;
+}
+
+void Ut_NotificationManager::benchmarkInvokingAction()
+{
+    // Resident notifications are not removed when their actions are invoked
+    NotificationManager *manager = NotificationManager::instance();
+    QVariantHash hints;
+    hints.insert(NotificationManager::HINT_RESIDENT, true);
+    const QStringList actions(QStringList() << "action" << "Action");
+    QList<uint> ids;
+    for (int i = 0; i < 1000; ++i) {
+        ids.append(manager->Notify("appName", 0, "appIcon", "summary", "body", actions, hints, 0));
+    }
+    manager->flushDatabase();
+
+    connect(this, SIGNAL(actionInvoked(QString)), manager->notification(ids.first()), SIGNAL(actionInvoked(QString)));
+    connect(this, SIGNAL(actionInvoked(QString)), manager->notification(ids.at(ids.count() / 2)), SIGNAL(actionInvoked(QString)));
+    connect(this, SIGNAL(actionInvoked(QString)), manager->notification(ids.last()), SIGNAL(actionInvoked(QString)));
+
+    QSignalSpy spy(manager, SIGNAL(ActionInvoked(uint, QString)));
+    QBENCHMARK {
+        emit actionInvoked("action");
+        QCoreApplication::processEvents();
+    }
+    QVERIFY(spy.count() >= 3);
+    QCOMPARE(spy.at(0).at(0).toUInt(), ids.first());
+    QCOMPARE(spy.at(1).at(0).toUInt(), ids.at(ids.count() / 2));
+    QCOMPARE(spy.at(2).at(0).toUInt(), ids.last());
+    QCOMPARE(manager->notificationIds().count(), ids.count());
+}
+
 QTEST_MAIN(Ut_NotificationManager)
@@ -27,6 +27,7 @@ private slots:
     void testManagerIsSingleton();
     void testDatabaseConnectionSucceedsAndTablesAreOk();
     void testDatabaseConnectionSucceedsAndTablesAreNotOk();
+    void testHintsAreMigratedToNotificationsTable();
     void testFirstDatabaseConnectionFails();
     void testNotEnoughDiskSpaceToOpenDatabase();
     void testNotificationsAreRestoredOnConstruction();
@@ -34,12 +35,14 @@ private slots:
     void testCapabilities();
     void testAddingNotification();
     void testUpdatingExistingNotification();
+    void testPreparedStatementsAreReused();
     void testUpdatingInexistingNotification();
     void testRemovingExistingNotification();
     void testRemovingInexistingNotification();
     void testServerInformation();
     void testModifyingCategoryDefinitionUpdatesNotifications();
     void testUninstallingCategoryDefinitionRemovesNotifications();
+    void testReplacingNotificationUpdatesCategory();
     void testActionIsInvokedIfDefined();
     void testActionIsNotInvokedIfIncomplete();
     void testRemoteActionIsInvokedIfDefined();
@@ -50,6 +53,12 @@ private slots:
     void testRemoveRequested();
     void testImmediateExpiration();
     void testDelayedExpiration();
+    void testFlushingDatabase();
+    void testClosedNotificationIsNotExpired();
+    void benchmarkReplacingNotification_data();
+    void benchmarkReplacingNotification();
+    void benchmarkRestoringNotifications();
+    void benchmarkInvokingAction();
 
 signals:
     void actionInvoked(QString action);
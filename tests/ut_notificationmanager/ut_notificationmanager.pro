@@ -9,6 +9,7 @@ PKGCONFIG += mlite5
 SOURCES += \
     ut_notificationmanager.cpp \
     $$NOTIFICATIONSRCDIR/notificationmanager.cpp \
+    $$NOTIFICATIONSRCDIR/notificationdatabasewriter.cpp \
     $$NOTIFICATIONSRCDIR/lipsticknotification.cpp \
     $$STUBSDIR/stubbase.cpp \
 
@@ -16,6 +17,7 @@ SOURCES += \
 HEADERS += \
     ut_notificationmanager.h \
     $$NOTIFICATIONSRCDIR/notificationmanager.h \
+    $$NOTIFICATIONSRCDIR/notificationdatabasewriter.h \
     $$NOTIFICATIONSRCDIR/lipsticknotification.h \
     $$NOTIFICATIONSRCDIR/notificationmanageradaptor.h \
     $$NOTIFICATIONSRCDIR/categorydefinitionstore.h \
@@ -492,6 +492,17 @@ void Ut_QObjectListModel::testSynchronization()
     QCOMPARE(qvariant_cast<int>(rowsRemovedSpy.at(0).at(1)), 2);
     QCOMPARE(qvariant_cast<int>(rowsRemovedSpy.at(0).at(2)), 2);
 
+    // Items inserted and moved by synchronization are removed when they are destroyed
+    QObject *b = objects->takeAt(1);
+    QObject *c = objects->takeAt(1);
+    model.synchronizeList(QList<QObject *>() << c << objects->at(0) << b);
+    QCOMPARE(model.itemCount(), 3);
+    delete b;
+    QCOMPARE(model.itemCount(), 2);
+    delete c;
+    QCOMPARE(model.itemCount(), 1);
+    QCOMPARE(::objectName(model.get(0)), QString("a"));
+
     qDeleteAll(*objects);
     delete objects;
 }
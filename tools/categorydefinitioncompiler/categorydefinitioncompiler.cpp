@@ -0,0 +1,65 @@
+/***************************************************************************
+**
+** Copyright (C) 2015 Jolla Ltd.
+**
+** This file is part of lipstick.
+**
+** This library is free software; you can redistribute it and/or
+** modify it under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation
+** and appearing in the file LICENSE.LGPL included in the packaging
+** of this file.
+**
+****************************************************************************/
+
+#include "categorydefinitionbundle.h"
+
+#include <QCoreApplication>
+#include <QDir>
+
+#include <iostream>
+
+// The default directory of the category definition files
+static const char *DEFAULT_CATEGORY_DEFINITION_DIRECTORY = "/usr/share/lipstick/notificationcategories";
+
+// Prints usage information
+int usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [DIRECTORY [BUNDLE]]" << std::endl;
+    std::cerr << "Compile the notification category definition files in DIRECTORY into a single bundle." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "DIRECTORY defaults to " << DEFAULT_CATEGORY_DEFINITION_DIRECTORY << "." << std::endl;
+    std::cerr << "BUNDLE defaults to DIRECTORY.bundle, which is where lipstick looks for the bundle." << std::endl;
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    const QStringList arguments(application.arguments().mid(1));
+    if (arguments.count() > 2 || arguments.contains("--help")) {
+        return usage(argv[0]);
+    }
+
+    const QString directory(QDir::cleanPath(arguments.value(0, QString(DEFAULT_CATEGORY_DEFINITION_DIRECTORY))));
+    const QString bundlePath(arguments.value(1, directory + ".bundle"));
+
+    QDir categoryDefinitionsDir(directory);
+    if (!categoryDefinitionsDir.exists()) {
+        std::cerr << "Directory does not exist: " << directory.toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    QStringList files;
+    foreach (const QString &file, categoryDefinitionsDir.entryList(QStringList("*.conf"), QDir::Files)) {
+        files.append(categoryDefinitionsDir.filePath(file));
+    }
+
+    if (!CategoryDefinitionBundle::compile(files, bundlePath)) {
+        std::cerr << "Unable to write bundle: " << bundlePath.toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
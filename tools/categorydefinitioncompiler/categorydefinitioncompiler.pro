@@ -0,0 +1,23 @@
+TEMPLATE = app
+TARGET = categorydefinitioncompiler
+
+QT += core
+
+INSTALLS = target
+target.path = /usr/bin
+
+DEPENDPATH += "../../src/notifications"
+INCLUDEPATH += "../../src/notifications"
+
+HEADERS += \
+     ../../src/notifications/categorydefinitionbundle.h
+SOURCES += \
+     categorydefinitioncompiler.cpp \
+     ../../src/notifications/categorydefinitionbundle.cpp
+
+QMAKE_CXXFLAGS += \
+    -Werror \
+    -g \
+    -std=c++0x \
+    -fvisibility=hidden \
+    -fvisibility-inlines-hidden